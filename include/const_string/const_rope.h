@@ -0,0 +1,137 @@
+#ifndef CONST_STRING_CONST_ROPE_H
+#define CONST_STRING_CONST_ROPE_H
+
+#include "const_string.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * Sequence of const_string pieces that represents their concatenation without copying any characters: Appending a
+ * piece only stores a reference to its buffer. The characters are only copied (into a single, exactly sized buffer),
+ * when contiguous data is needed (flatten).
+ *
+ * The pieces can be accessed directly via chunks(), e.g. to write them out with a scatter/gather call like writev.
+ */
+template<class CntPolicy>
+class basic_const_rope {
+public:
+	using String_t  = basic_const_string<CntPolicy>;
+	using ZString_t = basic_const_zstring<CntPolicy>;
+
+	using const_iterator = typename std::vector<String_t>::const_iterator;
+
+	basic_const_rope() = default;
+
+	basic_const_rope( String_t str ) { append( std::move( str ) ); }
+
+	basic_const_rope& append( String_t str )
+	{
+		if( !str.empty() ) {
+			_size += str.size();
+			_chunks.push_back( std::move( str ) );
+		}
+		return *this;
+	}
+
+	basic_const_rope& append( const basic_const_rope& other )
+	{
+		if( &other == this ) {
+			// insert must not get iterators into the vector itself
+			const std::size_t cnt = _chunks.size();
+			_chunks.reserve( 2 * cnt );
+			for( std::size_t i = 0; i < cnt; ++i ) {
+				_chunks.push_back( _chunks[i] );
+			}
+		} else {
+			_chunks.insert( _chunks.end(), other._chunks.begin(), other._chunks.end() );
+		}
+		_size += other._size;
+		return *this;
+	}
+
+	basic_const_rope& operator+=( String_t str ) { return append( std::move( str ) ); }
+	basic_const_rope& operator+=( const basic_const_rope& other ) { return append( other ); }
+
+	// total number of characters
+	std::size_t size() const noexcept { return _size; }
+	bool        empty() const noexcept { return _size == 0; }
+
+	const std::vector<String_t>& chunks() const noexcept { return _chunks; }
+
+	const_iterator begin() const noexcept { return _chunks.begin(); }
+	const_iterator end() const noexcept { return _chunks.end(); }
+
+	void reserve_chunks( std::size_t cnt ) { _chunks.reserve( cnt ); }
+
+	/**
+	 * Returns the concatenation of all pieces as a zero terminated string.
+	 * A rope consisting of a single piece doesn't need to copy the characters, if the piece is already zero terminated.
+	 */
+	ZString_t flatten() const
+	{
+		if( _chunks.empty() ) {
+			return ZString_t{};
+		}
+		if( _chunks.size() == 1 ) {
+			return ZString_t( _chunks.front() );
+		}
+		if( _size <= String_t::sso_capacity ) {
+			char buffer[String_t::sso_capacity + 1];
+			_write_to( buffer );
+			return ZString_t( std::string_view( buffer, _size ) );
+		}
+
+		auto res = detail::allocate_null_terminated_char_buffer<CntPolicy>( _size );
+		_write_to( res.data );
+		return detail::string_from_buffer::make<ZString_t>( std::move( res.handle ), res.data, _size );
+	}
+
+	friend bool operator==( const basic_const_rope& l, std::string_view r ) noexcept
+	{
+		if( l.size() != r.size() ) {
+			return false;
+		}
+		for( const auto& chunk : l._chunks ) {
+			if( r.substr( 0, chunk.size() ) != chunk ) {
+				return false;
+			}
+			r.remove_prefix( chunk.size() );
+		}
+		return true;
+	}
+	friend bool operator!=( const basic_const_rope& l, std::string_view r ) noexcept { return !( l == r ); }
+
+private:
+	void _write_to( char* buffer ) const noexcept
+	{
+		for( const auto& chunk : _chunks ) {
+			buffer = std::copy_n( chunk.data(), chunk.size(), buffer );
+		}
+	}
+
+	std::vector<String_t> _chunks;
+	std::size_t           _size = 0;
+};
+
+template<class CntPolicy>
+basic_const_rope<CntPolicy> operator+( basic_const_rope<CntPolicy> l, basic_const_string<CntPolicy> r )
+{
+	l.append( std::move( r ) );
+	return l;
+}
+
+template<class CntPolicy>
+basic_const_rope<CntPolicy> operator+( basic_const_rope<CntPolicy> l, const basic_const_rope<CntPolicy>& r )
+{
+	l.append( r );
+	return l;
+}
+
+using const_rope       = basic_const_rope<detail::atomic_ref_cnt_policy>;
+using local_const_rope = basic_const_rope<detail::local_ref_cnt_policy>;
+
+#endif
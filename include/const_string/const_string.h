@@ -1,82 +1,361 @@
 #ifndef CONST_STRING_CONST_STRING_H
 #define CONST_STRING_CONST_STRING_H
 
+#include "detail/delimiter_scanner.h"
+#include "detail/format.h"
+#include "detail/parallel.h"
 #include "detail/ref_cnt_buf.h"
 
 #include <algorithm>
 #include <atomic>
+#include <functional>
+#include <iterator>
+#include <limits>
 #include <memory>
+#include <memory_resource>
 #include <numeric>
+#include <stdexcept>
+#include <string>
 #include <string_view>
+#include <type_traits>
 #include <vector>
 
-class const_zstring;
-class const_string : public std::string_view {
-	using Base_t = std::string_view;
+// Strings up to this length are stored inside the const_string object itself instead of a ref counted heap buffer.
+// Set to 0 to disable the small string optimization.
+#ifndef CONST_STRING_SSO_CAPACITY
+#define CONST_STRING_SSO_CAPACITY 15
+#endif
+
+template<class CntPolicy>
+class basic_const_string;
+template<class CntPolicy>
+class basic_const_zstring;
+template<class CntPolicy, class Finder>
+class basic_split_view;
+
+namespace detail {
+template<class C, class = void>
+constexpr bool has_reserve_v = false;
+
+template<class C>
+constexpr bool has_reserve_v<C, std::void_t<decltype( std::declval<C&>().reserve( std::size_t{} ) )>> = true;
+
+// Wraps a buffer into a const_string or const_zstring without copying (for the containers and builders of the library)
+struct string_from_buffer {
+	template<class String, class CntPolicy>
+	static String make( basic_ref_cnt_buffer<CntPolicy>&& handle, const char* data, std::size_t size )
+	{
+		return String( std::move( handle ), data, size );
+	}
+};
+} // namespace detail
+
+// thread safe reference counting (default)
+using const_string  = basic_const_string<detail::atomic_ref_cnt_policy>;
+using const_zstring = basic_const_zstring<detail::atomic_ref_cnt_policy>;
+
+// non-atomic reference counting. Objects (and all copies thereof) must not be shared between threads
+using local_const_string  = basic_const_string<detail::local_ref_cnt_policy>;
+using local_const_zstring = basic_const_zstring<detail::local_ref_cnt_policy>;
+
+template<class Range>
+const_zstring join( const Range& strings, std::string_view separator, std::size_t thread_cnt = 0 );
+
+/**
+ * Monotonic arena for const_strings: Dropping the last reference to a string that was allocated from the arena is a
+ * no-op. All memory is released at once, when the arena gets destroyed, so it has to outlive all strings allocated
+ * from it. Like std::pmr::monotonic_buffer_resource, an arena must not be used from multiple threads concurrently.
+ */
+class const_string_arena {
+public:
+	const_string_arena() = default;
+	explicit const_string_arena( std::size_t initial_size )
+		: _resource( initial_size )
+	{
+	}
+	explicit const_string_arena( std::pmr::memory_resource* upstream )
+		: _resource( upstream )
+	{
+	}
+	const_string_arena( void* buffer, std::size_t buffer_size )
+		: _resource( buffer, buffer_size )
+	{
+	}
+
+	std::pmr::memory_resource& resource() noexcept { return _resource; }
+
+	detail::allocation_source source() noexcept { return {&_resource, true}; }
+
+private:
+	std::pmr::monotonic_buffer_resource _resource;
+};
 
+/**
+ * RAII guard that makes all const_string allocations on the current thread, which don't get an explicit memory
+ * resource (construction from std::string_view, unshare, createZStr, concat), use the given resource or arena.
+ * Scopes can be nested. The previous setting is restored on destruction.
+ */
+class const_string_allocation_scope {
 public:
+	explicit const_string_allocation_scope( std::pmr::memory_resource& resource ) noexcept
+		: const_string_allocation_scope( detail::allocation_source{&resource, false} )
+	{
+	}
+
+	explicit const_string_allocation_scope( const_string_arena& arena ) noexcept
+		: const_string_allocation_scope( arena.source() )
+	{
+	}
+
+	const_string_allocation_scope( const const_string_allocation_scope& ) = delete;
+	const_string_allocation_scope& operator=( const const_string_allocation_scope& ) = delete;
+
+	~const_string_allocation_scope() { detail::current_allocation_source() = _previous; }
+
+private:
+	explicit const_string_allocation_scope( detail::allocation_source source ) noexcept
+		: _previous( std::exchange( detail::current_allocation_source(), source ) )
+	{
+	}
+
+	detail::allocation_source _previous;
+};
+
+class const_string_literal;
+
+namespace const_string_literals {
+constexpr const_string_literal operator""_cs( const char* str, std::size_t size ) noexcept;
+} // namespace const_string_literals
+
+/**
+ * String literal with its length and hash (detail::string_hash, the same function as const_string::hash) computed at
+ * compile time. Converts to const_string and const_zstring without allocation.
+ *
+ *   using namespace const_string_literals;
+ *   constexpr auto key = "content-length"_cs;
+ */
+class const_string_literal {
+public:
+	// NOTE: Use only for string literals (arrays with static storage duration)!!!
+	template<std::size_t N>
+	constexpr const_string_literal( const char ( &str )[N] ) noexcept
+		: const_string_literal( str, N - 1 )
+	{
+	}
+
+	constexpr std::string_view view() const noexcept { return _str; }
+	constexpr operator std::string_view() const noexcept { return _str; }
+
+	constexpr const char* data() const noexcept { return _str.data(); }
+	constexpr const char* c_str() const noexcept { return _str.data(); }
+	constexpr std::size_t size() const noexcept { return _str.size(); }
+	constexpr bool        empty() const noexcept { return _str.empty(); }
+
+	constexpr std::size_t hash() const noexcept { return _hash; }
+
+private:
+	friend constexpr const_string_literal const_string_literals::operator""_cs( const char*, std::size_t ) noexcept;
+
+	constexpr const_string_literal( const char* str, std::size_t size ) noexcept
+		: _str( str, size )
+		, _hash( detail::string_hash( _str ) )
+	{
+	}
+
+	std::string_view _str;
+	std::size_t      _hash;
+};
+
+namespace const_string_literals {
+constexpr const_string_literal operator""_cs( const char* str, std::size_t size ) noexcept
+{
+	return const_string_literal( str, size );
+}
+} // namespace const_string_literals
+
+template<class CntPolicy>
+class basic_const_string : public std::string_view {
+	using Base_t    = std::string_view;
+	using Buffer_t  = detail::basic_ref_cnt_buffer<CntPolicy>;
+	using ZString_t = basic_const_zstring<CntPolicy>;
+
+public:
+	static constexpr std::size_t sso_capacity = CONST_STRING_SSO_CAPACITY;
+
 	/* #################### CTORS ########################## */
 	// Default ConstString points at empty string
-	constexpr const_string() noexcept = default;
+	constexpr basic_const_string() noexcept = default;
+
+	basic_const_string( std::string_view other ) { _copyFrom( other, detail::current_allocation_source() ); }
+
+	// Allocates the copy from the given memory resource (e.g. a std::pmr::unsynchronized_pool_resource)
+	basic_const_string( std::string_view other, std::pmr::memory_resource& resource )
+	{
+		_copyFrom( other, detail::allocation_source{&resource, false} );
+	}
 
-	const_string( std::string_view other ) { _copyFrom( other ); }
+	basic_const_string( std::string_view other, const_string_arena& arena ) { _copyFrom( other, arena.source() ); }
+
+	/**
+	 * Takes ownership of the string's buffer instead of copying the characters. Short strings (sso) are still copied,
+	 * as are all strings while an allocation scope is active (the memory wouldn't come from the scope's resource) and
+	 * strings whose unused capacity would be wasteful to keep alive (see shrink_if_wasteful).
+	 */
+	basic_const_string( std::string&& other )
+	{
+		if( other.size() <= sso_capacity || detail::current_allocation_source().resource != nullptr
+			|| _is_wasteful( other.capacity(), other.size(), default_waste_ratio, default_min_waste ) ) {
+			_copyFrom( other, detail::current_allocation_source() );
+			return;
+		}
+		_data                      = Buffer_t::template make_owner<std::string>( std::move( other ) );
+		const std::string_view str = *_data.template get_owner<std::string>();
+		_data.set_payload( str );
+		this->_as_strview() = str;
+	}
+
+	/**
+	 * Takes ownership of data[0] ... data[size-1] without copying it. deleter( data ) is called when the last
+	 * reference is dropped (or immediately, if the string is short enough to be copied into the sso buffer).
+	 * data[size] is only accessed, if zero_terminated is set.
+	 */
+	template<class Deleter>
+	static basic_const_string adopt( char* data, std::size_t size, Deleter deleter, bool zero_terminated = false )
+	{
+		if( size <= sso_capacity ) {
+			basic_const_string ret;
+			ret._copyFrom( std::string_view( data, size ), detail::allocation_source{} );
+			deleter( data );
+			return ret;
+		}
+
+		Buffer_t handle;
+		try {
+			handle = Buffer_t::template make_owner<detail::adopted_buffer<Deleter>>( data, std::move( deleter ) );
+		} catch( ... ) {
+			deleter( data );
+			throw;
+		}
+		handle.set_payload( std::string_view( data, size ), zero_terminated );
+		return basic_const_string( std::move( handle ), data, size );
+	}
+
+	template<class Deleter>
+	static basic_const_string
+	adopt( std::unique_ptr<char[], Deleter> buffer, std::size_t size, bool zero_terminated = false )
+	{
+		Deleter deleter = std::move( buffer.get_deleter() );
+		return adopt( buffer.release(), size, std::move( deleter ), zero_terminated );
+	}
 
 	// NOTE: Use only for string literals (arrays with static storage duration)!!!
 	template<size_t N>
-	constexpr const_string( const char ( &other )[N] ) noexcept
+	constexpr basic_const_string( const char ( &other )[N] ) noexcept
 		: std::string_view( other )
 	// we don't have to initialize the shared_ptr to anything as string litterals already have static lifetime
 	{
 	}
 
+	constexpr basic_const_string( const_string_literal str ) noexcept
+		: std::string_view( str.view() )
+	{
+	}
+
 	// don't accept c-strings in the form of pointer
 	// if you need to create a const_string from a c string use the explicit conversion to string_view
 	template<class T>
-	const_string( T const* const& other ) = delete;
+	basic_const_string( T const* const& other ) = delete;
+
+	/**
+	 * Conversion between strings with different reference count policies. The buffer is only shared if that is
+	 * safe: A local_const_string created from a const_string keeps the original buffer alive through a local proxy
+	 * (a single atomic increment) and converting such a string back unwraps the proxy.
+	 * Everything else gets copied.
+	 */
+	template<class OtherPolicy, class = std::enable_if_t<!std::is_same_v<OtherPolicy, CntPolicy>>>
+	explicit basic_const_string( const basic_const_string<OtherPolicy>& other )
+	{
+		if( other._is_sso() ) {
+			_init_sso( other );
+		} else if( !other._data ) {
+			// static lifetime - nothing to manage
+			this->_as_strview() = other._as_strview();
+		} else if( auto original = other._data.template get_owner<Buffer_t>() ) {
+			this->_as_strview() = other._as_strview();
+			_data               = *original;
+		} else if constexpr( OtherPolicy::thread_safe ) {
+			this->_as_strview() = other._as_strview();
+			_data               = Buffer_t::template make_owner<detail::basic_ref_cnt_buffer<OtherPolicy>>( other._data );
+			_data.set_payload( other._data.payload(), other._data.payload_zero_terminated() );
+		} else {
+			_copyFrom( other, detail::current_allocation_source() );
+		}
+	}
 
 	/* ############### Special member functions ######################################## */
-	const_string( const const_string& other ) noexcept = default;
-	const_string& operator=( const const_string& other ) noexcept = default;
+	// NOTE: A string in sso mode points into its own object, so copies and moves have to re-target the view
+	basic_const_string( const basic_const_string& other ) noexcept
+		: std::string_view( other )
+		, _data( other._data )
+	{
+		if( other._is_sso() ) {
+			_init_sso( other );
+		}
+	}
+
+	basic_const_string& operator=( const basic_const_string& other ) noexcept
+	{
+		if( this == &other ) {
+			return *this;
+		}
+		_data = other._data;
+		if( other._is_sso() ) {
+			_init_sso( other );
+		} else {
+			this->_as_strview() = other._as_strview();
+		}
+		return *this;
+	}
 
-	const_string( const_string&& other ) noexcept
+	basic_const_string( basic_const_string&& other ) noexcept
 		: std::string_view( std::exchange( other._as_strview(), std::string_view{} ) )
 		, _data( std::move( other._data ) )
 	{
+		if( _in_sso_of( *this, other ) ) {
+			_init_sso( *this );
+		}
 	}
 
-	const_string& operator=( const_string&& other ) noexcept
+	basic_const_string& operator=( basic_const_string&& other ) noexcept
 	{
 		this->_as_strview() = std::exchange( other._as_strview(), std::string_view{} );
 		_data               = std::move( other._data );
+		if( _in_sso_of( *this, other ) ) {
+			_init_sso( *this );
+		}
 		return *this;
 	}
 
 	/* ################## String functions  ################################# */
-	const_string substr( size_t offset = 0, size_t count = npos ) const
+	basic_const_string substr( size_t offset = 0, size_t count = npos ) const
 	{
-		const_string retval;
-		retval._as_strview() = this->_as_strview().substr( offset, count );
-		retval._data         = this->_data;
-		return retval;
+		return _slice( this->_as_strview().substr( offset, count ) );
 	}
 
-	const_string substr( std::string_view range ) const
+	basic_const_string substr( std::string_view range ) const
 	{
 		assert( data() <= range.data() && range.data() + range.size() <= data() + size() );
-		const_string retval;
-		retval._as_strview() = range;
-		retval._data         = this->_data;
-		return retval;
+		return _slice( range );
 	}
 
-	const_string substr( iterator start, iterator end ) const
+	basic_const_string substr( iterator start, iterator end ) const
 	{
 		// UGLY: start-begin()+data() is necessary to convert from an iterator to a pointer on platforms where they are
 		// not the same type
 		return substr( std::string_view( start - begin() + data(), static_cast<size_type>( end - start ) ) );
 	}
 
-	const_string substr_sentinel( size_t offset, char sentinel ) const
+	basic_const_string substr_sentinel( size_t offset, char sentinel ) const
 	{
 		const auto size = this->find( sentinel, offset );
 		return substr( offset, size == npos ? this->size() - offset : size - offset );
@@ -84,7 +363,7 @@ public:
 
 	enum class Split { Drop, Before, After };
 
-	std::pair<const_string, const_string> split_at_pos( std::size_t i ) const
+	std::pair<basic_const_string, basic_const_string> split_at_pos( std::size_t i ) const
 	{
 		assert( i < size() || i == npos );
 		if( i == npos ) {
@@ -93,7 +372,7 @@ public:
 		return {substr( 0, i ), substr( i, npos )};
 	}
 
-	std::pair<const_string, const_string> split_at_pos( std::size_t i, Split s ) const
+	std::pair<basic_const_string, basic_const_string> split_at_pos( std::size_t i, Split s ) const
 	{
 		assert( i < size() || i == npos );
 		if( i == npos ) {
@@ -102,282 +381,961 @@ public:
 		return {substr( 0, i + ( s == Split::After ) ), substr( i + ( s == Split::After || s == Split::Drop ), npos )};
 	}
 
-	std::pair<const_string, const_string> split_first( char c = ' ', Split s = Split::Drop ) const
+	std::pair<basic_const_string, basic_const_string> split_first( char c = ' ', Split s = Split::Drop ) const
 	{
 		auto pos = this->find( c );
 		return split_at_pos( pos, s );
 	}
 
-	std::pair<const_string, const_string> split_last( char c = ' ', Split s = Split::Drop ) const
+	std::pair<basic_const_string, basic_const_string> split_last( char c = ' ', Split s = Split::Drop ) const
 	{
 		auto pos = this->rfind( c );
 		return split_at_pos( pos, s );
 	}
 
-	struct split_range;
+	enum class EmptyTokens { Keep, Skip };
+
+	using split_view        = basic_split_view<CntPolicy, detail::any_of_finder>;
+	using split_string_view = basic_split_view<CntPolicy, detail::substring_finder>;
+
+	// Lazy views of the tokens that split_full would return (optionally without empty ones). Tokens are only created
+	// when an iterator is dereferenced and don't require any allocations
+	split_view        split_lazy( char delimiter, EmptyTokens empty = EmptyTokens::Keep ) const;
+	split_string_view split_lazy( std::string_view delimiter, EmptyTokens empty = EmptyTokens::Keep ) const;
+	split_view        split_lazy_any_of( std::string_view delimiters, EmptyTokens empty = EmptyTokens::Keep ) const;
 
-	split_range split_lazy( char delimiter ) const;
+	// NOTE: Reservation turned out not to be beneficial on my particular machine for a given benchmarK
+	// Only use Reserve::Exact (which requires an additional, but fast counting pass) after measuring the benefit.
+	enum class Reserve { None, Exact };
 
-	std::vector<const_string> split_full( char delimiter ) const
+	std::vector<basic_const_string> split_full( char delimiter, Reserve reserve = Reserve::None ) const
 	{
-		std::vector<const_string> ret;
-		if( size() == 0 ) {
-			return ret;
+		std::vector<basic_const_string> ret;
+		split_into( delimiter, ret, reserve );
+		return ret;
+	}
+
+	// strings shorter than this are split on the calling thread only
+	static constexpr std::size_t parallel_split_min_chunk = 256 * 1024;
+
+	/**
+	 * Returns the same tokens as split_full, but splits the string on up to thread_cnt threads (0: one per core).
+	 * The string is partitioned at delimiters into one chunk per thread. The workers count the tokens of their chunk
+	 * first and then write them directly to their position in the result. The reference count is only modified
+	 * once for all tokens. Throws std::length_error if there are more than INT_MAX - 1 tokens (the reference count is
+	 * an int).
+	 */
+	std::vector<basic_const_string> split_full_parallel( char delimiter, std::size_t thread_cnt = 0 ) const
+	{
+		const std::size_t chunk_cnt
+			= std::min( detail::default_thread_cnt( thread_cnt ), this->size() / parallel_split_min_chunk );
+		if( chunk_cnt <= 1 || _is_sso() ) {
+			return split_full( delimiter );
 		}
-		// NOTE: Reservation turned out not to be beneficial on my particular machine for a given benchmarK
-		// Only re-add after measurements have show the benefit.
-		//ret.reserve( 3 );  //Arbitrarily chosen value
+		detail::stats().split_call();
+
+		// chunk i is [bounds[i], bounds[i+1]). Each chunk but the last ends right after a delimiter, so splitting the
+		// chunks separately results in the same tokens as splitting the whole string
+		const std::string_view   self_view = this->_as_strview();
+		std::vector<std::size_t> bounds( chunk_cnt + 1, self_view.size() );
+		bounds[0] = 0;
+		for( std::size_t i = 1; i < chunk_cnt; ++i ) {
+			const auto start = std::max( bounds[i - 1], i * ( self_view.size() / chunk_cnt ) );
+			const auto pos   = self_view.find( delimiter, start );
+			bounds[i]        = pos == std::string_view::npos ? self_view.size() : pos + 1;
+		}
+		const auto chunk = [&]( std::size_t i ) {
+			return self_view.substr( bounds[i], bounds[i + 1] - bounds[i] );
+		};
+
+		const detail::delimiter_set delimiters( delimiter );
+		std::vector<std::size_t>    offsets( chunk_cnt + 1, 0 );
+		detail::run_parallel( chunk_cnt, [&]( std::size_t i ) {
+			offsets[i + 1] = _count_tokens_in( chunk( i ), delimiters );
+		} );
+		std::partial_sum( offsets.begin(), offsets.end(), offsets.begin() );
+		_check_token_cnt( offsets.back() );
+
+		std::vector<basic_const_string> ret( offsets.back() );
+		detail::run_parallel( chunk_cnt, [&]( std::size_t i ) {
+			basic_const_string* out = ret.data() + offsets[i];
+			_for_each_token_in( chunk( i ), delimiters, [&]( std::string_view slice ) {
+				// ref count will be incremented at the end, once all workers are done
+				*out++ = basic_const_string( slice, _data, detail::defer_ref_cnt_tag_t{} );
+			} );
+		} );
+		_data.add_ref_cnt( static_cast<int>( ret.size() ) ); // checked above
+		return ret;
+	}
 
-		std::string_view self_view = this->_as_strview();
+	// Like split_full( char ), but splits at every character contained in delimiters (in a single pass)
+	std::vector<basic_const_string> split_full_any_of( std::string_view delimiters,
+													   Reserve          reserve = Reserve::None ) const
+	{
+		std::vector<basic_const_string> ret;
+		_split_append( detail::delimiter_set( delimiters ), ret, reserve );
+		return ret;
+	}
 
-		std::size_t start_pos = 0;
-		std::size_t found_pos = 0;
-		try {
-			while( found_pos != std::string_view::npos && start_pos != this->size() ) {
+	// Appends the tokens split_full would return to a container (e.g. a reused std::vector).
+	// Throws std::length_error if there are more than INT_MAX - 1 tokens; the tokens appended until then are kept.
+	template<class Container>
+	void split_into( char delimiter, Container& out, Reserve reserve = Reserve::None ) const
+	{
+		_split_append( detail::delimiter_set( delimiter ), out, reserve );
+	}
 
-				found_pos = this->find( delimiter, start_pos );
+	/**
+	 * Writes the tokens split_full would return to out[0] ... out[capacity-1]. Returns the total number of tokens.
+	 * If that is bigger than capacity, only the first capacity tokens have been written.
+	 * As the reference count is an int, std::length_error is thrown (before anything is written) if more than
+	 * INT_MAX - 1 tokens could be written, i.e. if both capacity and size() + 1 exceed INT_MAX - 1.
+	 */
+	std::size_t split_into( char delimiter, basic_const_string* out, std::size_t capacity ) const
+	{
+		detail::stats().split_call();
+		std::size_t cnt = 0;
+		if( _is_sso() ) {
+			_for_each_token( detail::delimiter_set( delimiter ), [&]( std::string_view slice ) {
+				if( cnt < capacity ) {
+					out[cnt] = _slice( slice );
+				}
+				cnt++;
+			} );
+			return cnt;
+		}
+		// a string of n characters has at most n + 1 tokens
+		_check_token_cnt( std::min( capacity, this->size() + 1 ) );
 
-				// std::string_view::substr(offset,count) allows count to be bigger than size,
-				// so we don't have to check for npos here
-				const auto new_slice = self_view.substr( start_pos, found_pos - start_pos );
+		_for_each_token( detail::delimiter_set( delimiter ), [&]( std::string_view slice ) {
+			if( cnt < capacity ) {
+				// ref count will be incremented at the end, once the total number of slices is known
+				out[cnt] = basic_const_string( slice, _data, detail::defer_ref_cnt_tag_t{} );
+			}
+			cnt++;
+		} );
+		_data.add_ref_cnt( static_cast<int>( std::min( cnt, capacity ) ) ); // checked above
+		return cnt;
+	}
 
-				// ref count will be incremented at the end of the function, once the total number of slices will be known
-				// constructor is private, so we can't use emplace_back here
-				ret.emplace_back( new_slice, _data, detail::defer_ref_cnt_tag_t{} );
+	/**
+	 * Creates a const_string for each range in ranges (string_views pointing into this string, e.g. produced by a
+	 * parser) and appends them to out. The reference count is incremented only once for the whole batch.
+	 */
+	template<class Ranges, class Container>
+	void slices_into( const Ranges& ranges, Container& out ) const
+	{
+		_append_slices( out, [&]( auto&& emit ) {
+			for( std::string_view range : ranges ) {
+				assert( this->data() <= range.data() && range.data() + range.size() <= this->data() + this->size() );
+				emit( range );
+			}
+		} );
+	}
 
-				start_pos = found_pos + 1;
+	template<class Ranges>
+	std::vector<basic_const_string> slices( const Ranges& ranges ) const
+	{
+		std::vector<basic_const_string> ret;
+		slices_into( ranges, ret );
+		return ret;
+	}
+
+	// Calls emit( std::string_view ) for each token split_full would return, without creating a const_string for it
+	template<class Emit>
+	void for_each_token( char delimiter, Emit&& emit ) const
+	{
+		_for_each_token( detail::delimiter_set( delimiter ), emit );
+	}
+
+	// Number of tokens split_full would return
+	std::size_t count_tokens( char delimiter ) const { return _count_tokens( detail::delimiter_set( delimiter ) ); }
+
+	std::size_t count_tokens_any_of( std::string_view delimiters ) const
+	{
+		return _count_tokens( detail::delimiter_set( delimiters ) );
+	}
+
+	bool isZeroTerminated() const
+	{
+		// the character behind the payload might not belong to the buffer, so we must not read it
+		if( _data ) {
+			const auto payload = _data.payload();
+			if( this->data() + size() == payload.data() + payload.size() ) {
+				return _data.payload_zero_terminated();
+			}
+		}
+		return this->data()[size()] == '\0';
+	}
+
+	/**
+	 * Returns detail::string_hash( *this ). If this string spans the whole buffer, the hash is cached in the buffer,
+	 * so it only has to be computed once for all copies. Substrings, literals and inline strings compute it every time.
+	 */
+	std::size_t hash() const noexcept
+	{
+		if( _data ) {
+			const auto payload = _data.payload();
+			if( payload.data() == this->data() && payload.size() == this->size() ) {
+				return _data.payload_hash();
 			}
-		} catch( ... ) {
-			_data.add_ref_cnt( static_cast<int>( ret.size() ) );
-			throw;
 		}
+		return detail::string_hash( *this );
+	}
 
-		_data.add_ref_cnt( static_cast<int>( ret.size() ) );
+	ZString_t unshare() const;
+	ZString_t createZStr() const&;
+	ZString_t createZStr() &&;
 
-		return ret;
+	/* ############### Retained memory ######################################## */
+	// Number of characters in the buffer this string keeps alive (0 for literals and inline strings)
+	std::size_t retained_bytes() const noexcept { return _data ? _data.payload().size() : 0; }
+
+	// Number of retained characters that are not part of this string (e.g. the rest of the parent of a substring)
+	std::size_t wasted_bytes() const noexcept
+	{
+		const auto retained = retained_bytes();
+		return retained > size() ? retained - size() : 0;
 	}
 
-	bool isZeroTerminated() const { return this->data()[size()] == '\0'; }
+	static constexpr double      default_waste_ratio = 4.0;
+	static constexpr std::size_t default_min_waste   = 4096;
+
+	/**
+	 * Replaces this string by a copy (see unshare), if the retained buffer is more than max_ratio times the size of
+	 * this string and the copy releases at least min_waste bytes. Returns true if the string got copied.
+	 */
+	bool shrink_if_wasteful( double max_ratio = default_waste_ratio, std::size_t min_waste = default_min_waste )
+	{
+		if( _data.is_immortal() || !_is_wasteful( retained_bytes(), size(), max_ratio, min_waste ) ) {
+			return false;
+		}
+		detail::stats().compacted( wasted_bytes() );
+		*this = unshare();
+		return true;
+	}
 
-	const_zstring unshare() const;
-	const_zstring createZStr() const&;
-	const_zstring createZStr() &&;
+	/**
+	 * Like shrink_if_wasteful for each string in strings, but strings sharing a buffer are considered together:
+	 * They are only copied, if their combined size is small compared to the buffer (i.e. many slices that cover most
+	 * of their buffer are left alone). Returns the number of copied strings.
+	 */
+	template<class Range>
+	static std::size_t compact( Range&      strings,
+								double      max_ratio = default_waste_ratio,
+								std::size_t min_waste = default_min_waste )
+	{
+		const auto viewed = _viewed_per_buffer( strings );
 
-	constexpr const_string( std::string_view                     sv,
-							const detail::atomic_ref_cnt_buffer& data,
-							detail::defer_ref_cnt_tag_t )
-		: std::string_view( sv )
-		, _data{data, detail::defer_ref_cnt_tag_t{}}
+		std::size_t cnt = 0;
+		for( basic_const_string& str : strings ) {
+			const auto retained = str.retained_bytes();
+			if( retained == 0 || str._data.is_immortal() ) {
+				continue;
+			}
+			const char* const start  = str._data.payload().data();
+			const auto        before = []( const auto& l, const char* r ) {
+				return std::less<const char*>{}( l.first.data(), r );
+			};
+			const auto it = std::lower_bound( viewed.begin(), viewed.end(), start, before );
+			assert( it != viewed.end() && it->first.data() == start );
+			if( _is_wasteful( retained, it->second, max_ratio, min_waste ) ) {
+				detail::stats().compacted( str.wasted_bytes() );
+				str = str.unshare();
+				cnt++;
+			}
+		}
+		return cnt;
+	}
+
+	/**
+	 * Number of bytes the buffers of strings keep alive that are not part of any of the strings, i.e. the waste
+	 * compact( strings ) could release at most. Computed on demand, there is no global gauge of the currently pinned
+	 * waste (the statistics only count waste that has been released).
+	 */
+	template<class Range>
+	static std::size_t pinned_waste( const Range& strings )
 	{
+		std::size_t waste = 0;
+		for( const auto& [payload, size] : _viewed_per_buffer( strings ) ) {
+			waste += payload.size() > size ? payload.size() - size : 0;
+		}
+		return waste;
 	}
-protected:
-	detail::atomic_ref_cnt_buffer _data;
 
-	class static_lifetime_tag {
-	};
-	constexpr const_string( std::string_view sv, static_lifetime_tag )
+	/* ############### Immortal strings ######################################## */
+	/**
+	 * Marks the buffer of this string as immortal: It is never freed and neither this string nor copies made from it
+	 * afterwards modify the reference count (just like string literals). Meant for heap strings that live until the
+	 * end of the program anyway (e.g. configuration values or names loaded at startup).
+	 * Has no effect on strings without buffer (literals, inline strings).
+	 * NOTE: Buffers from a monotonic allocation scope are still released together with their memory resource
+	 */
+	basic_const_string& make_immortal() & noexcept
+	{
+		_data.make_immortal();
+		return *this;
+	}
+
+	basic_const_string&& make_immortal() && noexcept { return std::move( make_immortal() ); }
+
+	// true if the buffer of this string has been made immortal (see make_immortal)
+	bool is_immortal() const noexcept { return _data.is_immortal(); }
+
+	constexpr basic_const_string( std::string_view sv, const Buffer_t& data, detail::defer_ref_cnt_tag_t )
 		: std::string_view( sv )
+		, _data{data, detail::defer_ref_cnt_tag_t{}}
 	{
 	}
 
+	// number of references to the underlying buffer (0 for literals and strings stored inline)
+	int get_ref_cnt() const { return _data.get_ref_cnt(); }
+
+protected:
+	template<class OtherPolicy>
+	friend class basic_const_string;
+	friend struct detail::string_from_buffer;
 
 	/**
-	 * private constructor, that takes ownership of a buffer and a size (used in _copyFrom and _concat_impl)
+	 * Low level constructor, that takes ownership of a buffer. [data, data+size) has to stay valid as long as the
+	 * buffer is alive. Never uses the small string optimization, so all copies share the same characters.
+	 * Other parts of the library use it via detail::string_from_buffer.
 	 */
-	const_string( detail::atomic_ref_cnt_buffer&& handle, const char* data, size_t size )
+	basic_const_string( Buffer_t&& handle, const char* data, size_t size )
 		: std::string_view( data, size )
 		, _data( std::move( handle ) )
 	{
 	}
 
-	friend void swap( const_string& l, const_string& r )
+	Buffer_t _data;
+	// inline storage for short strings (zero terminated). Only in use if data() points here
+	char _sso[sso_capacity + 1]{};
+
+	class static_lifetime_tag {
+	};
+	constexpr basic_const_string( std::string_view sv, static_lifetime_tag )
+		: std::string_view( sv )
+	{
+	}
+
+	friend void swap( basic_const_string& l, basic_const_string& r ) noexcept
 	{
-		using std::swap;
-		swap( l._as_strview(), r._as_strview() );
-		swap( l._data, r._data );
+		// can't just swap the members, as sso strings have to point into their own object
+		if( &l == &r ) {
+			return; // move assignment to self isn't allowed
+		}
+		basic_const_string tmp = std::move( l );
+		l                      = std::move( r );
+		r                      = std::move( tmp );
 	}
 
 	std::string_view& _as_strview() { return static_cast<std::string_view&>( *this ); }
 
 	const std::string_view& _as_strview() const { return static_cast<const std::string_view&>( *this ); }
 
-	void _copyFrom( const std::string_view other )
+	void _copyFrom( const std::string_view other, detail::allocation_source source )
 	{
-		if( other.data() == nullptr ) {
+		if( other.data() == nullptr || ( sso_capacity == 0 && other.empty() ) ) {
+			// nothing to copy (and without sso no buffer to copy an empty string into)
 			this->_as_strview() = std::string_view{""};
 			return;
 		}
+		if( _fits_sso( other.size() ) ) {
+			_init_sso( other );
+			detail::stats().sso();
+			return;
+		}
 		// create buffer and copy data over
-		auto result = detail::allocate_null_terminated_char_buffer( static_cast<int>( other.size() ) );
+		auto result = detail::allocate_null_terminated_char_buffer<CntPolicy>( other.size(), source );
 		std::copy_n( other.data(), other.size(), result.data );
 
 		// initialize ConstString data fields;
-		*this = const_string( std::move( result.handle ), result.data, other.size() );
+		*this = basic_const_string( std::move( result.handle ), result.data, other.size() );
+	}
+
+	static constexpr bool _fits_sso( std::size_t size ) noexcept { return sso_capacity > 0 && size <= sso_capacity; }
+
+	// whether view points into the sso buffer of owner (used by moves, after the view has been taken from owner)
+	static bool _in_sso_of( std::string_view view, const basic_const_string& owner ) noexcept
+	{
+		return sso_capacity > 0 && view.data() == owner._sso;
+	}
+
+	bool _is_sso() const noexcept { return _in_sso_of( *this, *this ); }
+
+	// combined size of all strings per buffer (identified by their payload), sorted by the start of the payload
+	template<class Range>
+	static std::vector<std::pair<std::string_view, std::size_t>> _viewed_per_buffer( const Range& strings )
+	{
+		std::vector<std::pair<std::string_view, std::size_t>> viewed;
+		for( const basic_const_string& str : strings ) {
+			if( str.retained_bytes() != 0 ) {
+				viewed.emplace_back( str._data.payload(), str.size() );
+			}
+		}
+		const auto by_start = []( const auto& l, const auto& r ) {
+			return std::less<const char*>{}( l.first.data(), r.first.data() );
+		};
+		std::sort( viewed.begin(), viewed.end(), by_start );
+		std::size_t out = 0;
+		for( std::size_t i = 0; i < viewed.size(); ++i ) {
+			if( out != 0 && viewed[out - 1].first.data() == viewed[i].first.data() ) {
+				viewed[out - 1].second += viewed[i].second;
+			} else {
+				viewed[out++] = viewed[i];
+			}
+		}
+		viewed.resize( out );
+		return viewed;
+	}
+
+	static bool _is_wasteful( std::size_t retained, std::size_t viewed, double max_ratio, std::size_t min_waste ) noexcept
+	{
+		return retained > viewed && retained - viewed >= min_waste
+			   && static_cast<double>( retained ) > max_ratio * static_cast<double>( viewed );
+	}
+
+	// copies str into the inline buffer and points the view at it. Doesn't touch _data.
+	void _init_sso( std::string_view str ) noexcept
+	{
+		assert( str.size() <= sso_capacity );
+		std::copy_n( str.data(), str.size(), _sso );
+		_sso[str.size()]    = '\0';
+		this->_as_strview() = std::string_view( _sso, str.size() );
+	}
+
+	// calls emit( slice ) for each token split_full would return
+	template<class Emit>
+	void _for_each_token( const detail::delimiter_set& delimiters, Emit&& emit ) const
+	{
+		_for_each_token_in( this->_as_strview(), delimiters, emit );
+	}
+
+	template<class Emit>
+	static void _for_each_token_in( const std::string_view str, const detail::delimiter_set& delimiters, Emit&& emit )
+	{
+		detail::delimiter_scanner scanner( str, delimiters );
+
+		std::size_t start_pos = 0;
+		std::size_t found_pos = 0;
+		while( found_pos != std::string_view::npos && start_pos != str.size() ) {
+			found_pos = scanner.next();
+
+			// std::string_view::substr(offset,count) allows count to be bigger than size,
+			// so we don't have to check for npos here
+			emit( str.substr( start_pos, found_pos - start_pos ) );
+
+			start_pos = found_pos + 1;
+		}
+	}
+
+	std::size_t _count_tokens( const detail::delimiter_set& delimiters ) const
+	{
+		return _count_tokens_in( this->_as_strview(), delimiters );
+	}
+
+	static std::size_t _count_tokens_in( const std::string_view str, const detail::delimiter_set& delimiters )
+	{
+		if( str.empty() ) {
+			return 0;
+		}
+		// a trailing delimiter doesn't start a new token
+		detail::delimiter_scanner scanner( str, delimiters );
+		return scanner.count_remaining() + 1 - delimiters.contains( str.back() );
+	}
+
+	template<class Container>
+	void _split_append( const detail::delimiter_set& delimiters, Container& out, Reserve reserve ) const
+	{
+		detail::stats().split_call();
+		if constexpr( detail::has_reserve_v<Container> ) {
+			if( reserve == Reserve::Exact ) {
+				out.reserve( out.size() + _count_tokens( delimiters ) );
+			}
+		}
+
+		_append_slices( out, [&]( auto&& emit ) { _for_each_token( delimiters, emit ); } );
+	}
+
+	// the reference count is an int that already includes our own reference, so a single call can hand out at most
+	// INT_MAX - 1 tokens
+	static void _check_token_cnt( std::size_t cnt )
+	{
+		if( cnt > static_cast<std::size_t>( std::numeric_limits<int>::max() - 1 ) ) {
+			throw std::length_error( "const_string: Too many tokens" );
+		}
+	}
+
+	// appends a slice of this string to out for each range generate_ranges( emit ) passes to emit
+	template<class Container, class RangeGenerator>
+	void _append_slices( Container& out, RangeGenerator&& generate_ranges ) const
+	{
+		if( _is_sso() ) {
+			// slices can't point into our inline buffer, so each of them gets its own (inline) copy
+			generate_ranges( [&]( std::string_view slice ) { out.push_back( _slice( slice ) ); } );
+			return;
+		}
+
+		std::size_t added = 0;
+		try {
+			generate_ranges( [&]( std::string_view slice ) {
+				// checked before the slice is created, so the slices already in out can always be accounted for
+				_check_token_cnt( added + 1 );
+				// ref count will be incremented at the end of the function, once the total number of slices will be known
+				// constructor is private, so we can't use emplace_back here
+				out.emplace_back( slice, _data, detail::defer_ref_cnt_tag_t{} );
+				added++;
+			} );
+		} catch( ... ) {
+			_data.add_ref_cnt( static_cast<int>( added ) );
+			throw;
+		}
+
+		_data.add_ref_cnt( static_cast<int>( added ) ); // checked above
+	}
+
+	// creates a const_string for a range inside of this string
+	basic_const_string _slice( std::string_view range ) const
+	{
+		basic_const_string retval;
+		if( _is_sso() ) {
+			retval._init_sso( range );
+		} else {
+			retval._as_strview() = range;
+			retval._data         = this->_data;
+		}
+		return retval;
 	}
 };
 
-class const_zstring : public const_string {
-	using const_string::const_string;
+template<class CntPolicy>
+class basic_const_zstring : public basic_const_string<CntPolicy> {
+	using Base_t = basic_const_string<CntPolicy>;
+	using Base_t::Base_t;
 
 public:
-	constexpr const_zstring()
-		: const_string( detail::getEmptyZeroTerminatedStringView(), const_string::static_lifetime_tag{} )
+	constexpr basic_const_zstring()
+		: Base_t( detail::getEmptyZeroTerminatedStringView(), typename Base_t::static_lifetime_tag{} )
+	{
+	}
+	basic_const_zstring( std::string_view other )
+		: Base_t( other.data() == nullptr ? detail::getEmptyZeroTerminatedStringView() : other )
 	{
 	}
-	const_zstring( std::string_view other )
-		: const_string( other.data() == nullptr ? detail::getEmptyZeroTerminatedStringView() : other )
+
+	// std::string is always zero terminated, so its buffer can be adopted as well
+	basic_const_zstring( std::string&& other )
+		: Base_t( std::move( other ) )
+	{
+	}
+
+	basic_const_zstring( const Base_t& other )
+		: Base_t( other.createZStr() )
 	{
 	}
 
-	const_zstring( const const_string& other )
-		: const_string( other.createZStr() )
+	basic_const_zstring( Base_t&& other )
+		: Base_t( std::move( other ).createZStr() )
 	{
 	}
 
-	const_zstring( const_string&& other )
-		: const_string( std::move( other ).createZStr() )
+	template<class OtherPolicy, class = std::enable_if_t<!std::is_same_v<OtherPolicy, CntPolicy>>>
+	explicit basic_const_zstring( const basic_const_string<OtherPolicy>& other )
+		: basic_const_zstring( Base_t( other ) )
 	{
 	}
 
 	// NOTE: Use only for string literals (arrays with static storage duration)!!!
 	template<size_t N>
-	constexpr const_zstring( const char ( &other )[N] ) noexcept
-		: const_string( other )
+	constexpr basic_const_zstring( const char ( &other )[N] ) noexcept
+		: Base_t( other )
+	{
+	}
+	// literals are always zero terminated
+	constexpr basic_const_zstring( const_string_literal str ) noexcept
+		: Base_t( str )
 	{
 	}
+
 	const char* c_str() const { return this->data(); }
 
+	basic_const_zstring& make_immortal() & noexcept
+	{
+		Base_t::make_immortal();
+		return *this;
+	}
+
+	basic_const_zstring&& make_immortal() && noexcept { return std::move( make_immortal() ); }
+
+	// range concatenations (concat, join) of at least this size are copied on several threads
+	static constexpr std::size_t parallel_concat_min_size = 16 * 1024 * 1024;
+	// minimal number of bytes per thread
+	static constexpr std::size_t parallel_concat_min_chunk = 4 * 1024 * 1024;
+
 private:
+	friend class basic_const_string<CntPolicy>;
+
+	class zero_terminated_tag {
+	};
+	// adopts a string that is already known to be zero terminated (used by createZStr)
+	basic_const_zstring( Base_t other, zero_terminated_tag ) noexcept
+		: Base_t( std::move( other ) )
+	{
+		assert( this->isZeroTerminated() );
+	}
+
 	template<class ARG1, class... ARGS>
 	friend auto concat( const ARG1 arg1, const ARGS&... args )
-		-> std::enable_if_t<std::is_convertible_v<ARG1, std::string_view>, const_zstring>;
+		-> std::enable_if_t<detail::is_concat_arg_v<ARG1> && ( detail::is_concat_arg_v<ARGS> && ... ), const_zstring>;
 
 	template<class T>
-	friend auto concat( const T& args ) -> std::enable_if_t<!std::is_convertible_v<T, std::string_view>, const_zstring>;
+	friend auto concat( const T& args ) -> std::enable_if_t<!detail::is_concat_arg_v<T>, const_zstring>;
+
+	template<class Range>
+	friend const_zstring join( const Range& strings, std::string_view separator, std::size_t thread_cnt );
 
 	//######## impl helper for concat ###############
-	static void _addTo( char*& buffer, const std::string_view str )
+	// The callers size the buffer for all parts. end only makes the bound visible to the compiler, nothing is cut off
+	static void _addTo( char*& buffer, const char* end, const std::string_view str )
 	{
-		buffer = std::copy_n( str.data(), str.size(), buffer );
+		buffer = std::copy_n( str.data(), std::min( str.size(), static_cast<std::size_t>( end - buffer ) ), buffer );
+	}
+
+	// formatted numbers and padded strings (see detail::to_concat_part)
+	template<class Part>
+	static void _addTo( char*& buffer, const char* end, const Part& part )
+	{
+		if( part.size() <= static_cast<std::size_t>( end - buffer ) ) {
+			part.write( buffer );
+		}
 	}
 
 	template<class... ARGS>
-	inline static void _write_to_buffer( char* buffer, const ARGS&... args )
+	inline static void _write_to_buffer( char* buffer, const char* end, const ARGS&... args )
 	{
-		( _addTo( buffer, args ), ... );
+		( _addTo( buffer, end, args ), ... );
 	}
 
 	template<class... ARGS>
-	inline static const_zstring _concat_var_impl( const ARGS&... args )
+	inline static basic_const_zstring _concat_var_impl( const ARGS&... args )
 	{
+		detail::stats().concat_call();
 		const size_t newSize = ( 0 + ... + args.size() );
-		auto         res     = detail::allocate_null_terminated_char_buffer( static_cast<int>( newSize ) );
-		_write_to_buffer( res.data, args... );
-		return const_zstring( std::move( res.handle ), res.data, newSize );
+		if( Base_t::_fits_sso( newSize ) ) {
+			basic_const_zstring ret;
+			_write_to_buffer( ret._sso, ret._sso + std::min( newSize, Base_t::sso_capacity ), args... );
+			ret._finish_sso( newSize );
+			return ret;
+		}
+		auto res = detail::allocate_null_terminated_char_buffer<CntPolicy>( newSize );
+		_write_to_buffer( res.data, res.data + newSize, args... );
+		return basic_const_zstring( std::move( res.handle ), res.data, newSize );
 	}
 
-	template<class T>
-	inline static const_zstring _concat_range_impl( const std::vector<T>& args )
+	// points the view at the first size characters of the sso buffer, which have already been written
+	void _finish_sso( std::size_t size ) noexcept
+	{
+		this->_sso[size]    = '\0';
+		this->_as_strview() = std::string_view( this->_sso, size );
+		detail::stats().sso();
+	}
+
+	// concatenates all strings of a (forward) range with separator between them
+	template<class Range>
+	static basic_const_zstring
+	_concat_range_impl( const Range& strings, std::string_view separator, std::size_t thread_cnt )
 	{
-		const size_t newSize
-			= std::accumulate( args.begin(), args.end(), std::size_t( 0 ), []( std::size_t s, const auto& str ) {
-				  return s + str.size();
-			  } );
+		detail::stats().concat_call();
+		std::size_t cnt     = 0;
+		std::size_t newSize = 0;
+		for( auto&& e : strings ) {
+			newSize += std::string_view( e ).size();
+			cnt++;
+		}
+		if( cnt > 1 ) {
+			newSize += ( cnt - 1 ) * separator.size();
+		}
 
-		auto res = detail::allocate_null_terminated_char_buffer( static_cast<int>( newSize ) );
-		auto ptr = res.data;
-		for( auto&& e : args ) {
-			_addTo( ptr, std::string_view( e ) );
+		if( Base_t::_fits_sso( newSize ) ) {
+			basic_const_zstring ret;
+			_write_range( ret._sso, ret._sso + std::min( newSize, Base_t::sso_capacity ), strings, separator );
+			ret._finish_sso( newSize );
+			return ret;
+		}
+
+		auto res = detail::allocate_null_terminated_char_buffer<CntPolicy>( newSize );
+		const std::size_t chunk_cnt
+			= newSize < parallel_concat_min_size
+				  ? 1
+				  : std::min( detail::default_thread_cnt( thread_cnt ), newSize / parallel_concat_min_chunk );
+		if( chunk_cnt > 1 ) {
+			_write_range_parallel( res.data, newSize, strings, cnt, separator, chunk_cnt );
+		} else {
+			_write_range( res.data, res.data + newSize, strings, separator );
 		}
-		return const_zstring( std::move( res.handle ), ptr, newSize );
+		return basic_const_zstring( std::move( res.handle ), res.data, newSize );
+	}
+
+	template<class Range>
+	static void _write_range( char* buffer, const char* end, const Range& strings, std::string_view separator )
+	{
+		bool first = true;
+		for( auto&& e : strings ) {
+			if( !first ) {
+				_addTo( buffer, end, separator );
+			}
+			_addTo( buffer, end, std::string_view( e ) );
+			first = false;
+		}
+	}
+
+	/**
+	 * The output is partitioned into equally sized parts, one per thread. Each thread copies the parts of the strings
+	 * (and separators) that overlap with its part of the output, so a single huge string gets split up as well.
+	 */
+	template<class Range>
+	static void _write_range_parallel( char*            buffer,
+									   std::size_t      total_size,
+									   const Range&     strings,
+									   std::size_t      cnt,
+									   std::string_view separator,
+									   std::size_t      chunk_cnt )
+	{
+		// position of each string in the output
+		std::vector<std::string_view> views;
+		std::vector<std::size_t>      offsets;
+		views.reserve( cnt );
+		offsets.reserve( cnt );
+		std::size_t offset = 0;
+		for( auto&& e : strings ) {
+			views.push_back( std::string_view( e ) );
+			offsets.push_back( offset );
+			offset += views.back().size() + separator.size();
+		}
+
+		detail::run_parallel( chunk_cnt, [&]( std::size_t i ) {
+			const std::size_t begin = total_size / chunk_cnt * i;
+			const std::size_t end   = i + 1 == chunk_cnt ? total_size : total_size / chunk_cnt * ( i + 1 );
+
+			// copies the part of src, which starts at pos in the output, that lies within [begin, end)
+			const auto copy_overlap = [&]( std::string_view src, std::size_t pos ) {
+				const auto first = std::max( begin, pos );
+				const auto last  = std::min( end, pos + src.size() );
+				if( first < last ) {
+					std::copy_n( src.data() + ( first - pos ), last - first, buffer + first );
+				}
+			};
+
+			// start with the last string that starts at or before begin (offsets[0] == 0 <= begin)
+			const auto next = std::upper_bound( offsets.begin(), offsets.end(), begin );
+			for( auto k = static_cast<std::size_t>( next - offsets.begin() ) - 1; k < views.size() && offsets[k] < end;
+				 ++k ) {
+				copy_overlap( views[k], offsets[k] );
+				if( k + 1 < views.size() ) {
+					copy_overlap( separator, offsets[k] + views[k].size() );
+				}
+			}
+		} );
 	}
 };
 
-inline const_zstring const_string::unshare() const
+template<class CntPolicy>
+basic_const_zstring<CntPolicy> basic_const_string<CntPolicy>::unshare() const
 {
-	return const_zstring( static_cast<std::string_view>( *this ) );
+	detail::stats().unshare_call();
+	return ZString_t( static_cast<std::string_view>( *this ) );
 }
 
-inline const_zstring const_string::createZStr() const&
+template<class CntPolicy>
+basic_const_zstring<CntPolicy> basic_const_string<CntPolicy>::createZStr() const&
 {
 	if( isZeroTerminated() ) {
-		return *this; // just copy
+		return ZString_t( *this, typename ZString_t::zero_terminated_tag{} ); // just copy
 	} else {
 		return unshare();
 	}
 }
 
-inline const_zstring const_string::createZStr() &&
+template<class CntPolicy>
+basic_const_zstring<CntPolicy> basic_const_string<CntPolicy>::createZStr() &&
 {
 	if( isZeroTerminated() ) {
-		return std::move( *this ); // already zero terminated - just move
+		// already zero terminated - just move
+		return ZString_t( std::move( *this ), typename ZString_t::zero_terminated_tag{} );
 	} else {
 		return unshare();
 	}
 }
 
-struct const_string::split_range {
-	const const_string* full_string;
-	std::size_t   pos;
-	char          del;
-	struct end_iterator_t {
-	};
+/**
+ * Forward range over the tokens of a const_string. The view keeps a copy of the string, so it can't dangle.
+ * Iterators store the boundaries of the current token, so each delimiter is searched only once and dereferencing
+ * is O(1) (it returns a new const_string that shares the buffer of the original).
+ * Like split_full, a trailing delimiter doesn't start a new (empty) token.
+ */
+template<class CntPolicy, class Finder>
+class basic_split_view {
+	using String_t = basic_const_string<CntPolicy>;
 
-	split_range& operator++()
-	{
-		pos = full_string->find( del, pos );
-		if( pos != npos ) {
-			pos++;
+public:
+	class iterator {
+	public:
+		using iterator_concept  = std::forward_iterator_tag;
+		using iterator_category = std::input_iterator_tag; // operator* doesn't return a reference
+		using value_type        = String_t;
+		using difference_type   = std::ptrdiff_t;
+		using reference         = String_t;
+		using pointer           = void;
+
+		iterator() noexcept = default;
+
+		String_t operator*() const
+		{
+			assert( _pos != npos );
+			return _str->substr( std::string_view( _str->data() + _pos, _token_end() - _pos ) );
 		}
-		return *this;
-	}
-	const_string operator*() const {
-		return full_string->substr_sentinel( pos, del );
-	}
 
-	split_range    begin() const { return *this; }
-	end_iterator_t end() const { return {}; }
+		iterator& operator++()
+		{
+			_advance();
+			_skip_empty_tokens();
+			return *this;
+		}
 
+		iterator operator++( int )
+		{
+			auto tmp = *this;
+			++*this;
+			return tmp;
+		}
 
+		friend bool operator==( const iterator& l, const iterator& r ) noexcept { return l._pos == r._pos; }
+		friend bool operator!=( const iterator& l, const iterator& r ) noexcept { return !( l == r ); }
 
-	friend bool operator==( split_range l, split_range r )
-	{
-		return l.full_string == r.full_string && l.pos == r.pos;
-	}
-	friend bool operator!=( split_range l, split_range r ) { return !( l == r ); }
+	private:
+		friend class basic_split_view;
 
-	friend bool operator==( split_range l, end_iterator_t )
-	{
-		if( l.pos == const_string::npos || l.full_string == nullptr || l.full_string->size() == l.pos ) {
-			return true;
+		static constexpr std::size_t npos = std::string_view::npos;
+
+		iterator( const String_t* str, std::string_view delimiters, bool skip_empty )
+			: _str( str )
+			, _finder( *str, delimiters )
+			, _skip_empty( skip_empty )
+		{
+			if( _str->empty() ) {
+				return;
+			}
+			_pos = 0;
+			_end = _finder.next();
+			_skip_empty_tokens();
 		}
-		return false;
-	}
-	friend bool operator!=( split_range l, end_iterator_t r )
+
+		std::size_t _token_end() const noexcept { return _end == npos ? _str->size() : _end; }
+
+		void _advance() noexcept
+		{
+			if( _end == npos ) {
+				_pos = npos;
+				return;
+			}
+			_pos = _end + _finder.delimiter_size();
+			if( _pos == _str->size() ) {
+				_pos = npos;
+				return;
+			}
+			_end = _finder.next();
+		}
+
+		void _skip_empty_tokens() noexcept
+		{
+			while( _skip_empty && _pos != npos && _token_end() == _pos ) {
+				_advance();
+			}
+		}
+
+		const String_t* _str = nullptr;
+		Finder          _finder{};
+		std::size_t     _pos        = npos; // start of the current token. npos for end iterator
+		std::size_t     _end        = npos; // position of the delimiter after the current token
+		bool            _skip_empty = false;
+	};
+
+	basic_split_view() = default;
+
+	basic_split_view( String_t str, std::string_view delimiters, bool skip_empty )
+		: _str( std::move( str ) )
+		, _delimiters( delimiters )
+		, _skip_empty( skip_empty )
 	{
-		return !( l == r );
 	}
+
+	iterator begin() const { return iterator( &_str, _delimiters, _skip_empty ); }
+	iterator end() const { return iterator{}; }
+
+private:
+	String_t _str;
+	String_t _delimiters;
+	bool     _skip_empty = false;
 };
 
-inline const_string::split_range const_string::split_lazy( char delimiter ) const {
-	return const_string::split_range{this, 0, delimiter};
+#if defined( __cpp_lib_ranges )
+namespace std::ranges {
+template<class CntPolicy, class Finder>
+inline constexpr bool enable_view<basic_split_view<CntPolicy, Finder>> = true;
+}
+#endif
+
+template<class CntPolicy>
+auto basic_const_string<CntPolicy>::split_lazy( char delimiter, EmptyTokens empty ) const -> split_view
+{
+	detail::stats().split_call();
+	return split_view( *this, std::string_view( &delimiter, 1 ), empty == EmptyTokens::Skip );
+}
 
+template<class CntPolicy>
+auto basic_const_string<CntPolicy>::split_lazy( std::string_view delimiter, EmptyTokens empty ) const
+	-> split_string_view
+{
+	detail::stats().split_call();
+	return split_string_view( *this, delimiter, empty == EmptyTokens::Skip );
+}
+
+template<class CntPolicy>
+auto basic_const_string<CntPolicy>::split_lazy_any_of( std::string_view delimiters, EmptyTokens empty ) const
+	-> split_view
+{
+	detail::stats().split_call();
+	return split_view( *this, delimiters, empty == EmptyTokens::Skip );
 }
 
 /**
- * Function that can concatenate an arbitrary number of objects from which a std::string_view can be constructed
+ * Function that can concatenate an arbitrary number of objects from which a std::string_view can be constructed,
+ * characters, arithmetic values and formatted values (see concat_fmt). Numbers are written directly into the
+ * result, which is allocated only once.
  */
 template<class ARG1, class... ARGS>
 auto concat( const ARG1 arg1, const ARGS&... args )
-	-> std::enable_if_t<std::is_convertible_v<ARG1, std::string_view>, const_zstring>
+	-> std::enable_if_t<detail::is_concat_arg_v<ARG1> && ( detail::is_concat_arg_v<ARGS> && ... ), const_zstring>
 {
-	return const_zstring::_concat_var_impl( std::string_view( arg1 ), std::string_view( args )... );
+	return const_zstring::_concat_var_impl( detail::to_concat_part( arg1 ), detail::to_concat_part( args )... );
 }
 
+/**
+ * Concatenates all strings of a range (any range that can be iterated more than once, e.g. std::vector, std::deque,
+ * std::span or the chunks of a const_rope). Very long results (see parallel_concat_min_size) are copied on several
+ * threads.
+ */
 template<class T>
-auto concat( const T& args ) -> std::enable_if_t<!std::is_convertible_v<T, std::string_view>, const_zstring>
+auto concat( const T& args ) -> std::enable_if_t<!detail::is_concat_arg_v<T>, const_zstring>
+{
+	return const_zstring::_concat_range_impl( args, std::string_view{}, 0 );
+}
+
+// Like concat( range ), but with separator between consecutive strings. Uses up to thread_cnt threads (0: one per core)
+template<class Range>
+const_zstring join( const Range& strings, std::string_view separator, std::size_t thread_cnt )
 {
-	return const_zstring::_concat_range_impl( args );
+	return const_zstring::_concat_range_impl( strings, separator, thread_cnt );
 }
 
 inline const const_string& getEmptyConstString()
@@ -386,6 +1344,48 @@ inline const const_string& getEmptyConstString()
 	return str;
 }
 
+namespace std {
+template<class CntPolicy>
+struct hash<basic_const_string<CntPolicy>> {
+	std::size_t operator()( const basic_const_string<CntPolicy>& str ) const noexcept { return str.hash(); }
+};
+
+template<class CntPolicy>
+struct hash<basic_const_zstring<CntPolicy>> {
+	std::size_t operator()( const basic_const_zstring<CntPolicy>& str ) const noexcept { return str.hash(); }
+};
+
+template<>
+struct hash<const_string_literal> {
+	constexpr std::size_t operator()( const_string_literal str ) const noexcept { return str.hash(); }
+};
+} // namespace std
+
+/**
+ * Transparent hash and equality functors, that allow looking up const_strings in hash containers with a plain
+ * std::string_view (requires heterogeneous lookup support from the container). Produce the same hash values as
+ * std::hash<const_string>.
+ */
+struct const_string_hash {
+	using is_transparent = void;
+
+	std::size_t operator()( std::string_view str ) const noexcept { return detail::string_hash( str ); }
+
+	template<class CntPolicy>
+	std::size_t operator()( const basic_const_string<CntPolicy>& str ) const noexcept
+	{
+		return str.hash();
+	}
+
+	constexpr std::size_t operator()( const_string_literal str ) const noexcept { return str.hash(); }
+};
+
+struct const_string_equal {
+	using is_transparent = void;
+
+	bool operator()( std::string_view l, std::string_view r ) const noexcept { return l == r; }
+};
+
 #define CONST_STRING_DEFINE_CONST_STRING_COMPARATOR( NAME, CMP )                                                       \
 	template<class T1,                                                                                                 \
 			 class T2,                                                                                                 \
@@ -0,0 +1,166 @@
+#ifndef CONST_STRING_CONST_STRING_BUILDER_H
+#define CONST_STRING_CONST_STRING_BUILDER_H
+
+#include "const_string.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+/**
+ * Mutable buffer to build a string incrementally. The characters are written directly into a (growable) const_string
+ * buffer, which freeze() hands over to the resulting const_zstring, so - unlike building a std::string and
+ * constructing a const_string from it - the characters don't have to be copied at the end.
+ *
+ * NOTE: The memory always comes from malloc/realloc (not from the current allocation scope), as it has to be resizable
+ */
+template<class CntPolicy>
+class basic_const_string_builder {
+	using Buffer_t = detail::basic_ref_cnt_buffer<CntPolicy>;
+
+public:
+	using ZString_t = basic_const_zstring<CntPolicy>;
+
+	basic_const_string_builder() = default;
+	explicit basic_const_string_builder( std::size_t initial_capacity ) { reserve( initial_capacity ); }
+
+	basic_const_string_builder( const basic_const_string_builder& ) = delete;
+	basic_const_string_builder& operator=( const basic_const_string_builder& ) = delete;
+
+	basic_const_string_builder( basic_const_string_builder&& other ) noexcept
+		: _block( std::exchange( other._block, nullptr ) )
+		, _size( std::exchange( other._size, 0 ) )
+		, _capacity( std::exchange( other._capacity, 0 ) )
+	{
+	}
+
+	basic_const_string_builder& operator=( basic_const_string_builder&& other ) noexcept
+	{
+		basic_const_string_builder tmp( std::move( other ) );
+		std::swap( _block, tmp._block );
+		std::swap( _size, tmp._size );
+		std::swap( _capacity, tmp._capacity );
+		return *this;
+	}
+
+	~basic_const_string_builder() { Buffer_t::free_growable( _block ); }
+
+	// str may point into the builder itself (e.g. builder.append( builder.view() ))
+	basic_const_string_builder& append( std::string_view str )
+	{
+		// growing moves the block, so remember where str starts relative to it
+		const char* const chars = _chars();
+		const bool        alias = chars != nullptr && std::less_equal<const char*>{}( chars, str.data() )
+							&& std::less<const char*>{}( str.data(), chars + _size );
+		const std::size_t offset = alias ? static_cast<std::size_t>( str.data() - chars ) : 0;
+
+		reserve( _required_size( str.size() ) );
+		const char* const source = alias ? _chars() + offset : str.data();
+		std::copy_n( source, str.size(), _chars() + _size );
+		_size += str.size();
+		return *this;
+	}
+
+	basic_const_string_builder& append( std::size_t cnt, char c )
+	{
+		reserve( _required_size( cnt ) );
+		std::fill_n( _chars() + _size, cnt, c );
+		_size += cnt;
+		return *this;
+	}
+
+	basic_const_string_builder& push_back( char c ) { return append( 1, c ); }
+
+	basic_const_string_builder& operator+=( std::string_view str ) { return append( str ); }
+	basic_const_string_builder& operator+=( char c ) { return push_back( c ); }
+
+	// Throws std::length_error if capacity exceeds max_size()
+	void reserve( std::size_t capacity )
+	{
+		if( capacity > _capacity ) {
+			_grow( capacity );
+		}
+	}
+
+	std::size_t size() const noexcept { return _size; }
+	std::size_t capacity() const noexcept { return _capacity; }
+	bool        empty() const noexcept { return _size == 0; }
+
+	// one character of the largest possible buffer is reserved for the zero terminator
+	static constexpr std::size_t max_size() noexcept { return Buffer_t::max_size - 1; }
+
+	std::string_view view() const noexcept
+	{
+		return _block ? std::string_view( _chars(), _size ) : std::string_view{};
+	}
+
+	void clear() noexcept { _size = 0; }
+
+	/**
+	 * Returns the content as const_zstring and leaves the builder empty. The buffer is handed over as is (after
+	 * shrinking it in place, if a significant part of it is unused), only short strings are copied into the sso buffer.
+	 */
+	ZString_t freeze()
+	{
+		if( _size <= ZString_t::sso_capacity ) {
+			ZString_t ret( view() );
+			_size = 0; // keep the block for further use
+			return ret;
+		}
+
+		if( _capacity - _size > _size / 8 ) {
+			// shrinking usually doesn't have to move the block
+			_block    = Buffer_t::reallocate_growable( _block, _size + 1 );
+			_capacity = _size;
+		}
+		_chars()[_size] = '\0';
+
+		Buffer_t    handle = Buffer_t::adopt_growable( std::exchange( _block, nullptr ), _capacity + 1 );
+		char* const data   = handle.get();
+		handle.set_payload( std::string_view( data, _size ) );
+		_capacity = 0;
+		return detail::string_from_buffer::make<ZString_t>( std::move( handle ), data, std::exchange( _size, 0 ) );
+	}
+
+private:
+	static constexpr std::size_t min_capacity = 64;
+
+	// nullptr if no block has been allocated yet
+	char*       _chars() noexcept { return _block ? _block + Buffer_t::header_size : nullptr; }
+	const char* _chars() const noexcept { return _block ? _block + Buffer_t::header_size : nullptr; }
+
+	// _size + cnt, unless that exceeds max_size(). Checking cnt on its own first lets the optimizer see that the
+	// following writes are bounded (otherwise gcc warns about writing SIZE_MAX characters in append( SIZE_MAX, c ))
+	std::size_t _required_size( std::size_t cnt ) const
+	{
+		if( cnt > max_size() || _size > max_size() - cnt ) {
+			throw std::length_error( "const_string: String too long" );
+		}
+		return _size + cnt;
+	}
+
+	void _grow( std::size_t required )
+	{
+		if( required > max_size() ) {
+			throw std::length_error( "const_string: String too long" );
+		}
+		// doubling saturates at max_size()
+		const std::size_t doubled      = _capacity > max_size() / 2 ? max_size() : 2 * _capacity;
+		const std::size_t new_capacity = std::max( {required, doubled, min_capacity} );
+		// one additional byte for the zero terminator
+		_block    = Buffer_t::reallocate_growable( _block, new_capacity + 1 );
+		_capacity = new_capacity;
+	}
+
+	char*       _block    = nullptr;
+	std::size_t _size     = 0;
+	std::size_t _capacity = 0;
+};
+
+using const_string_builder       = basic_const_string_builder<detail::atomic_ref_cnt_policy>;
+using local_const_string_builder = basic_const_string_builder<detail::local_ref_cnt_policy>;
+
+#endif
@@ -0,0 +1,198 @@
+#ifndef CONST_STRING_CONST_STRING_VECTOR_H
+#define CONST_STRING_CONST_STRING_VECTOR_H
+
+#include "const_string.h"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+/**
+ * Compact sequence of slices of a single string (e.g. the tokens of split_full_flat). Instead of a const_string per
+ * element, it stores one copy of the parent string and a 32 bit offset / length pair per element (8 bytes instead of
+ * sizeof( const_string )). Elements are materialized on access: view( i ) returns a std::string_view and operator[]
+ * a const_string that shares the parent's buffer. Iteration yields string_views.
+ */
+template<class CntPolicy>
+class basic_const_string_vector {
+	struct Slice {
+		std::uint32_t offset;
+		std::uint32_t size;
+	};
+
+public:
+	using String_t  = basic_const_string<CntPolicy>;
+	using size_type = std::size_t;
+
+	basic_const_string_vector() = default;
+
+	// Empty vector of slices of parent. Throws std::length_error if parent is too big for 32 bit offsets
+	explicit basic_const_string_vector( String_t parent )
+		: _parent( std::move( parent ) )
+	{
+		if( _parent.size() > std::numeric_limits<std::uint32_t>::max() ) {
+			throw std::length_error( "const_string: String too big for a const_string_vector" );
+		}
+	}
+
+	// slice has to point into parent()
+	void push_back( std::string_view slice )
+	{
+		assert( _parent.data() <= slice.data() && slice.data() + slice.size() <= _parent.data() + _parent.size() );
+		const auto offset = static_cast<std::uint32_t>( slice.data() - _parent.data() );
+		_slices.push_back( Slice{offset, static_cast<std::uint32_t>( slice.size() )} );
+	}
+
+	void reserve( std::size_t n ) { _slices.reserve( n ); }
+	void clear() noexcept { _slices.clear(); }
+	void shrink_to_fit() { _slices.shrink_to_fit(); }
+
+	std::size_t size() const noexcept { return _slices.size(); }
+	std::size_t capacity() const noexcept { return _slices.capacity(); }
+	bool        empty() const noexcept { return _slices.empty(); }
+
+	std::string_view view( std::size_t i ) const noexcept
+	{
+		assert( i < size() );
+		return std::string_view( _parent.data() + _slices[i].offset, _slices[i].size );
+	}
+
+	String_t operator[]( std::size_t i ) const { return _parent.substr( view( i ) ); }
+
+	String_t at( std::size_t i ) const
+	{
+		if( i >= size() ) {
+			throw std::out_of_range( "const_string: const_string_vector index out of range" );
+		}
+		return ( *this )[i];
+	}
+
+	class view_iterator {
+	public:
+		using iterator_concept  = std::random_access_iterator_tag;
+		using iterator_category = std::input_iterator_tag; // operator* doesn't return a reference
+		using value_type        = std::string_view;
+		using difference_type   = std::ptrdiff_t;
+		using pointer           = const std::string_view*;
+		using reference         = std::string_view;
+
+		view_iterator() = default;
+
+		std::string_view operator*() const noexcept
+		{
+			return std::string_view( _chars + _slice->offset, _slice->size );
+		}
+		std::string_view operator[]( difference_type n ) const noexcept { return *( *this + n ); }
+
+		view_iterator& operator++() noexcept
+		{
+			++_slice;
+			return *this;
+		}
+		view_iterator operator++( int ) noexcept
+		{
+			auto ret = *this;
+			++_slice;
+			return ret;
+		}
+		view_iterator& operator--() noexcept
+		{
+			--_slice;
+			return *this;
+		}
+		view_iterator operator--( int ) noexcept
+		{
+			auto ret = *this;
+			--_slice;
+			return ret;
+		}
+		view_iterator& operator+=( difference_type n ) noexcept
+		{
+			_slice += n;
+			return *this;
+		}
+		view_iterator& operator-=( difference_type n ) noexcept
+		{
+			_slice -= n;
+			return *this;
+		}
+
+		friend view_iterator operator+( view_iterator it, difference_type n ) noexcept { return it += n; }
+		friend view_iterator operator+( difference_type n, view_iterator it ) noexcept { return it += n; }
+		friend view_iterator operator-( view_iterator it, difference_type n ) noexcept { return it -= n; }
+		friend difference_type operator-( view_iterator l, view_iterator r ) noexcept { return l._slice - r._slice; }
+
+		friend bool operator==( view_iterator l, view_iterator r ) noexcept { return l._slice == r._slice; }
+		friend bool operator!=( view_iterator l, view_iterator r ) noexcept { return l._slice != r._slice; }
+		friend bool operator<( view_iterator l, view_iterator r ) noexcept { return l._slice < r._slice; }
+		friend bool operator>( view_iterator l, view_iterator r ) noexcept { return l._slice > r._slice; }
+		friend bool operator<=( view_iterator l, view_iterator r ) noexcept { return l._slice <= r._slice; }
+		friend bool operator>=( view_iterator l, view_iterator r ) noexcept { return l._slice >= r._slice; }
+
+	private:
+		friend class basic_const_string_vector;
+		view_iterator( const char* chars, const Slice* slice ) noexcept
+			: _chars( chars )
+			, _slice( slice )
+		{
+		}
+
+		const char*  _chars = nullptr;
+		const Slice* _slice = nullptr;
+	};
+
+	view_iterator begin() const noexcept { return view_iterator( _parent.data(), _slices.data() ); }
+	view_iterator end() const noexcept { return view_iterator( _parent.data(), _slices.data() + _slices.size() ); }
+
+	// All elements as const_strings (the reference count of the parent is incremented only once for all of them)
+	std::vector<String_t> to_vector() const
+	{
+		std::vector<String_t> ret;
+		ret.reserve( size() );
+		_parent.slices_into( *this, ret );
+		return ret;
+	}
+
+	// the string all elements are slices of
+	const String_t& parent() const noexcept { return _parent; }
+
+private:
+	// offsets instead of pointers, so the slices stay valid if the parent is stored inline (sso) and gets moved
+	String_t           _parent;
+	std::vector<Slice> _slices;
+};
+
+/**
+ * Like str.split_full( delimiter, reserve ), but returns the tokens as offsets into (a copy of) str instead of a
+ * const_string per token, which needs a fraction of the memory
+ */
+template<class CntPolicy>
+basic_const_string_vector<CntPolicy> split_full_flat( const basic_const_string<CntPolicy>&            str,
+													  char                                            delimiter,
+													  typename basic_const_string<CntPolicy>::Reserve reserve )
+{
+	detail::stats().split_call();
+	basic_const_string_vector<CntPolicy> ret( str );
+	if( reserve == basic_const_string<CntPolicy>::Reserve::Exact ) {
+		ret.reserve( str.count_tokens( delimiter ) );
+	}
+	// the tokens have to point into the vector's copy of the string (which differs from str for sso strings)
+	ret.parent().for_each_token( delimiter, [&]( std::string_view slice ) { ret.push_back( slice ); } );
+	return ret;
+}
+
+template<class CntPolicy>
+basic_const_string_vector<CntPolicy> split_full_flat( const basic_const_string<CntPolicy>& str, char delimiter )
+{
+	return split_full_flat( str, delimiter, basic_const_string<CntPolicy>::Reserve::None );
+}
+
+using const_string_vector       = basic_const_string_vector<detail::atomic_ref_cnt_policy>;
+using local_const_string_vector = basic_const_string_vector<detail::local_ref_cnt_policy>;
+
+#endif
@@ -0,0 +1,302 @@
+#ifndef CONST_STRING_DETAIL_DELIMITER_SCANNER_H
+#define CONST_STRING_DETAIL_DELIMITER_SCANNER_H
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cassert>
+#include <cstdint>
+#include <string_view>
+
+#if defined( __x86_64__ ) || defined( _M_X64 ) || defined( __SSE2__ ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define CONST_STRING_HAS_SSE2 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined( CONST_STRING_HAS_SSE2 ) && ( defined( __GNUC__ ) || defined( _MSC_VER ) )
+#define CONST_STRING_HAS_AVX2 1
+#endif
+
+namespace detail {
+
+/**
+ * Set of characters that are treated as delimiters. Up to max_simd_cnt characters can be searched with simd
+ * instructions, bigger sets fall back to a table lookup.
+ */
+struct delimiter_set {
+	static constexpr int max_simd_cnt = 16;
+
+	delimiter_set() noexcept = default;
+
+	explicit delimiter_set( char c ) noexcept
+		: delimiter_set( std::string_view( &c, 1 ) )
+	{
+	}
+
+	explicit delimiter_set( std::string_view delimiters ) noexcept
+	{
+		for( char c : delimiters ) {
+			const auto idx = static_cast<unsigned char>( c );
+			if( table[idx] ) {
+				continue;
+			}
+			table[idx] = true;
+			if( cnt < max_simd_cnt ) {
+				chars[cnt] = c;
+			}
+			cnt++;
+		}
+	}
+
+	bool contains( char c ) const noexcept { return table[static_cast<unsigned char>( c )]; }
+
+	std::array<char, max_simd_cnt> chars{};
+	int                            cnt = 0;
+	std::bitset<256>               table{};
+};
+
+// Each function returns a mask with bit i set, if block[i] is a delimiter. block has to be 64 bytes long.
+using block_mask_fn_t = std::uint64_t ( * )( const char* block, const delimiter_set& delimiters ) noexcept;
+
+constexpr std::size_t scanner_block_size = 64;
+
+inline std::uint64_t block_mask_scalar( const char* block, const delimiter_set& delimiters ) noexcept
+{
+	std::uint64_t mask = 0;
+	for( std::size_t i = 0; i < scanner_block_size; ++i ) {
+		mask |= std::uint64_t( delimiters.contains( block[i] ) ) << i;
+	}
+	return mask;
+}
+
+#ifdef CONST_STRING_HAS_SSE2
+inline std::uint64_t block_mask_sse2( const char* block, const delimiter_set& delimiters ) noexcept
+{
+	std::uint64_t mask = 0;
+	for( int i = 0; i < 4; ++i ) {
+		const __m128i data = _mm_loadu_si128( reinterpret_cast<const __m128i*>( block + 16 * i ) );
+		__m128i       eq   = _mm_setzero_si128();
+		for( int d = 0; d < delimiters.cnt; ++d ) {
+			eq = _mm_or_si128( eq, _mm_cmpeq_epi8( data, _mm_set1_epi8( delimiters.chars[d] ) ) );
+		}
+		mask |= std::uint64_t( static_cast<unsigned>( _mm_movemask_epi8( eq ) ) ) << ( 16 * i );
+	}
+	return mask;
+}
+#endif
+
+#ifdef CONST_STRING_HAS_AVX2
+#ifdef __GNUC__
+__attribute__( ( target( "avx2" ) ) )
+#endif
+inline std::uint64_t block_mask_avx2( const char* block, const delimiter_set& delimiters ) noexcept
+{
+	const __m256i lo    = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( block ) );
+	const __m256i hi    = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( block + 32 ) );
+	__m256i       eq_lo = _mm256_setzero_si256();
+	__m256i       eq_hi = _mm256_setzero_si256();
+	for( int d = 0; d < delimiters.cnt; ++d ) {
+		const __m256i del = _mm256_set1_epi8( delimiters.chars[d] );
+		eq_lo             = _mm256_or_si256( eq_lo, _mm256_cmpeq_epi8( lo, del ) );
+		eq_hi             = _mm256_or_si256( eq_hi, _mm256_cmpeq_epi8( hi, del ) );
+	}
+	return std::uint64_t( static_cast<std::uint32_t>( _mm256_movemask_epi8( eq_lo ) ) )
+		   | ( std::uint64_t( static_cast<std::uint32_t>( _mm256_movemask_epi8( eq_hi ) ) ) << 32 );
+}
+
+inline bool cpu_supports_avx2() noexcept
+{
+#if defined( __GNUC__ )
+	return __builtin_cpu_supports( "avx2" );
+#else
+	int info[4];
+	__cpuid( info, 1 );
+	const bool os_saves_ymm = ( info[2] & ( 1 << 27 ) ) && ( info[2] & ( 1 << 28 ) ) && ( ( _xgetbv( 0 ) & 6 ) == 6 );
+	__cpuidex( info, 7, 0 );
+	return os_saves_ymm && ( info[1] & ( 1 << 5 ) );
+#endif
+}
+#endif
+
+// picks the best implementation for the current cpu (determined once)
+inline block_mask_fn_t select_block_mask_fn( const delimiter_set& delimiters ) noexcept
+{
+	if( delimiters.cnt > delimiter_set::max_simd_cnt ) {
+		return &block_mask_scalar;
+	}
+#if defined( CONST_STRING_HAS_AVX2 )
+	static const block_mask_fn_t fn = cpu_supports_avx2() ? &block_mask_avx2 : &block_mask_sse2;
+	return fn;
+#elif defined( CONST_STRING_HAS_SSE2 )
+	return &block_mask_sse2;
+#else
+	return &block_mask_scalar;
+#endif
+}
+
+inline int count_trailing_zeros( std::uint64_t v ) noexcept
+{
+	assert( v != 0 );
+#if defined( __GNUC__ )
+	return __builtin_ctzll( v );
+#elif defined( _MSC_VER ) && defined( _M_X64 )
+	unsigned long idx;
+	_BitScanForward64( &idx, v );
+	return static_cast<int>( idx );
+#else
+	int cnt = 0;
+	while( ( v & 1 ) == 0 ) {
+		v >>= 1;
+		cnt++;
+	}
+	return cnt;
+#endif
+}
+
+inline int popcount( std::uint64_t v ) noexcept
+{
+#if defined( __GNUC__ )
+	return __builtin_popcountll( v );
+#else
+	int cnt = 0;
+	for( ; v != 0; v &= v - 1 ) {
+		cnt++;
+	}
+	return cnt;
+#endif
+}
+
+/**
+ * Finds all delimiter positions in a string. The string is processed in blocks of 64 bytes, for each of which a
+ * bit mask of the delimiter positions is computed in one pass, so the delimiters of short fields don't require a
+ * separate search each.
+ */
+class delimiter_scanner {
+public:
+	static constexpr std::size_t npos = std::string_view::npos;
+
+	delimiter_scanner() noexcept = default;
+
+	delimiter_scanner( std::string_view str, const delimiter_set& delimiters, std::size_t start = 0 ) noexcept
+		: _str( str )
+		, _delimiters( delimiters )
+		, _fn( select_block_mask_fn( delimiters ) )
+		, _base( start )
+	{
+		if( _base < _str.size() ) {
+			_mask = _block_mask( _base );
+		}
+	}
+
+	// returns the position of the next delimiter or npos if there is none left
+	std::size_t next() noexcept
+	{
+		while( _mask == 0 ) {
+			_base += scanner_block_size;
+			if( _base >= _str.size() ) {
+				_base = _str.size();
+				return npos;
+			}
+			_mask = _block_mask( _base );
+		}
+		const std::size_t pos = _base + count_trailing_zeros( _mask );
+		_mask &= _mask - 1;
+		return pos;
+	}
+
+	// returns the number of delimiters, which next() would still return (and consumes them)
+	std::size_t count_remaining() noexcept
+	{
+		std::size_t cnt = popcount( _mask );
+		while( _base + scanner_block_size < _str.size() ) {
+			_base += scanner_block_size;
+			cnt += popcount( _block_mask( _base ) );
+		}
+		_mask = 0;
+		_base = _str.size();
+		return cnt;
+	}
+
+private:
+	std::uint64_t _block_mask( std::size_t offset ) const noexcept
+	{
+		const std::size_t remaining = _str.size() - offset;
+		if( remaining >= scanner_block_size ) {
+			return _fn( _str.data() + offset, _delimiters );
+		}
+		// last, partial block: don't read past the end of the string
+		char tail[scanner_block_size]{};
+		std::copy_n( _str.data() + offset, remaining, tail );
+		return _fn( tail, _delimiters ) & ( ( std::uint64_t( 1 ) << remaining ) - 1 );
+	}
+
+	std::string_view _str{};
+	delimiter_set    _delimiters{};
+	block_mask_fn_t  _fn   = &block_mask_scalar;
+	std::size_t      _base = 0;
+	std::uint64_t    _mask = 0;
+};
+
+inline std::size_t find_delimiter( std::string_view str, const delimiter_set& delimiters, std::size_t start = 0 )
+{
+	return delimiter_scanner( str, delimiters, start ).next();
+}
+
+/**
+ * Finders are used by the lazy split views to find the delimiters in a string one after another.
+ * next() returns the position of the next delimiter (or npos), delimiter_size() its length.
+ */
+
+// Splits at every character contained in a set
+class any_of_finder {
+public:
+	any_of_finder() noexcept = default;
+	any_of_finder( std::string_view str, std::string_view delimiters ) noexcept
+		: _scanner( str, delimiter_set( delimiters ) )
+	{
+	}
+
+	std::size_t next() noexcept { return _scanner.next(); }
+
+	static constexpr std::size_t delimiter_size() noexcept { return 1; }
+
+private:
+	delimiter_scanner _scanner;
+};
+
+// Splits at every (non-overlapping) occurrence of a delimiter string. An empty delimiter doesn't split at all
+class substring_finder {
+public:
+	static constexpr std::size_t npos = std::string_view::npos;
+
+	substring_finder() noexcept = default;
+	substring_finder( std::string_view str, std::string_view delimiter ) noexcept
+		: _str( str )
+		, _delimiter( delimiter )
+	{
+	}
+
+	std::size_t next() noexcept
+	{
+		if( _delimiter.empty() || _pos >= _str.size() ) {
+			return npos;
+		}
+		const auto found = _str.find( _delimiter, _pos );
+		_pos             = found == npos ? npos : found + _delimiter.size();
+		return found;
+	}
+
+	std::size_t delimiter_size() const noexcept { return _delimiter.size(); }
+
+private:
+	std::string_view _str{};
+	std::string_view _delimiter{};
+	std::size_t      _pos = 0;
+};
+
+} // namespace detail
+
+#endif
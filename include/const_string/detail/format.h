@@ -0,0 +1,181 @@
+#ifndef CONST_STRING_DETAIL_FORMAT_H
+#define CONST_STRING_DETAIL_FORMAT_H
+
+#include <algorithm>
+#include <cassert>
+#include <charconv>
+#include <cstddef>
+#include <cstdio>
+#include <string_view>
+#include <type_traits>
+
+/**
+ * Formatting options for arguments of concat. Arithmetic values can also be passed to concat directly (in decimal,
+ * floating point values in the shortest representation that round trips).
+ *
+ *   concat( "id=", concat_fmt::hex( id, 8 ), " load=", concat_fmt::fixed( load, 2 ), ' ', concat_fmt::pad( name, 10 ) )
+ */
+namespace concat_fmt {
+
+template<class T>
+struct arg {
+	T           value;
+	int         base      = 10;
+	std::size_t width     = 0; // minimal number of characters (right aligned)
+	char        fill      = ' ';
+	int         precision = -1; // digits after the decimal point for floating point values (-1: shortest)
+};
+
+// integer in hexadecimal (lower case, without prefix), by default zero padded to width
+template<class T>
+constexpr arg<T> hex( T value, std::size_t width = 0, char fill = '0' ) noexcept
+{
+	static_assert( std::is_integral_v<T>, "Only integers can be formatted as hex" );
+	return {value, 16, width, fill, -1};
+}
+
+// number or string, right aligned to width characters
+template<class T>
+constexpr auto pad( const T& value, std::size_t width, char fill = ' ' ) noexcept
+{
+	if constexpr( std::is_arithmetic_v<T> ) {
+		return arg<T>{value, 10, width, fill, -1};
+	} else {
+		return arg<std::string_view>{std::string_view( value ), 10, width, fill, -1};
+	}
+}
+
+// floating point value with a fixed number of digits after the decimal point
+template<class T>
+constexpr arg<T> fixed( T value, int precision, std::size_t width = 0, char fill = ' ' ) noexcept
+{
+	static_assert( std::is_floating_point_v<T>, "Only floating point values can be formatted with fixed precision" );
+	return {value, 10, width, fill, precision};
+}
+
+} // namespace concat_fmt
+
+namespace detail {
+
+/**
+ * Number formatted into an internal buffer (plus padding), so concat knows the exact size of the result before
+ * allocating it. Values that don't fit into the buffer in fixed notation fall back to scientific notation.
+ */
+class formatted_number {
+public:
+	template<class T>
+	explicit formatted_number( const concat_fmt::arg<T>& arg ) noexcept
+	{
+		char* const end = _format( arg );
+		_len            = static_cast<std::size_t>( end - _chars );
+		_pad            = arg.width > _len ? arg.width - _len : 0;
+		_fill           = arg.fill;
+	}
+
+	std::size_t size() const noexcept { return _pad + _len; }
+
+	void write( char*& buffer ) const noexcept
+	{
+		std::string_view digits( _chars, _len );
+		// zero padding goes between the sign and the digits
+		if( _fill == '0' && _pad != 0 && !digits.empty() && digits[0] == '-' ) {
+			*buffer++ = '-';
+			digits.remove_prefix( 1 );
+		}
+		buffer = std::fill_n( buffer, _pad, _fill );
+		buffer = std::copy_n( digits.data(), digits.size(), buffer );
+	}
+
+private:
+	// enough for any integer in base 2 and doubles in fixed notation up to 1e100 with a precision of 20
+	static constexpr std::size_t buffer_size = 128;
+
+	template<class T>
+	char* _format( const concat_fmt::arg<T>& arg ) noexcept
+	{
+		char* const last = _chars + buffer_size;
+		if constexpr( std::is_same_v<T, bool> ) {
+			const std::string_view str = arg.value ? "true" : "false";
+			return std::copy_n( str.data(), str.size(), _chars );
+		} else if constexpr( std::is_integral_v<T> ) {
+			return std::to_chars( _chars, last, arg.value, arg.base ).ptr;
+		} else {
+			static_assert( std::is_floating_point_v<T> );
+			const int precision = std::min( arg.precision, 100 );
+#if defined( __cpp_lib_to_chars )
+			if( precision < 0 ) {
+				return std::to_chars( _chars, last, arg.value ).ptr;
+			}
+			const auto res = std::to_chars( _chars, last, arg.value, std::chars_format::fixed, precision );
+			if( res.ec == std::errc{} ) {
+				return res.ptr;
+			}
+			return std::to_chars( _chars, last, arg.value, std::chars_format::scientific, precision ).ptr;
+#else
+			// no floating point support in std::to_chars
+			const auto value = static_cast<double>( arg.value );
+			int        len   = precision < 0 ? std::snprintf( _chars, buffer_size, "%.17g", value )
+											 : std::snprintf( _chars, buffer_size, "%.*f", precision, value );
+			if( len < 0 || static_cast<std::size_t>( len ) >= buffer_size ) {
+				len = std::snprintf( _chars, buffer_size, "%.*e", std::max( precision, 0 ), value );
+			}
+			return _chars + std::min( static_cast<std::size_t>( std::max( len, 0 ) ), buffer_size - 1 );
+#endif
+		}
+	}
+
+	char        _chars[buffer_size];
+	std::size_t _len  = 0;
+	std::size_t _pad  = 0;
+	char        _fill = ' ';
+};
+
+// string, right aligned to a minimal width
+struct padded_string {
+	std::string_view str;
+	std::size_t      pad;
+	char             fill;
+
+	std::size_t size() const noexcept { return pad + str.size(); }
+
+	void write( char*& buffer ) const noexcept
+	{
+		buffer = std::fill_n( buffer, pad, fill );
+		buffer = std::copy_n( str.data(), str.size(), buffer );
+	}
+};
+
+template<class T>
+struct is_concat_fmt_arg : std::false_type {
+};
+
+template<class T>
+struct is_concat_fmt_arg<concat_fmt::arg<T>> : std::true_type {
+};
+
+// Everything concat accepts as a single part of the result (as opposed to a range of strings)
+template<class T>
+constexpr bool is_concat_arg_v = std::is_convertible_v<const T&, std::string_view> || std::is_arithmetic_v<T>
+								 || is_concat_fmt_arg<T>::value;
+
+// converts an argument of concat into something that has a size() and can be written into the result
+template<class T>
+auto to_concat_part( const T& arg ) noexcept
+{
+	if constexpr( std::is_convertible_v<const T&, std::string_view> ) {
+		return std::string_view( arg );
+	} else if constexpr( std::is_same_v<T, char> ) {
+		// characters are appended as is (like std::string::operator+=), all other arithmetic types as numbers
+		return std::string_view( &arg, 1 );
+	} else if constexpr( std::is_arithmetic_v<T> ) {
+		return formatted_number( concat_fmt::arg<T>{arg} );
+	} else if constexpr( std::is_same_v<T, concat_fmt::arg<std::string_view>> ) {
+		return padded_string{arg.value, arg.width > arg.value.size() ? arg.width - arg.value.size() : 0, arg.fill};
+	} else {
+		return formatted_number( arg );
+	}
+}
+
+} // namespace detail
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef CONST_STRING_DETAIL_HASH_H
+#define CONST_STRING_DETAIL_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace detail {
+
+/**
+ * Hash function used for all const_strings (FNV-1a). It is constexpr, so hashes of literals can be computed at
+ * compile time and never returns 0, which marks a not yet computed hash in the buffer header.
+ */
+constexpr std::size_t string_hash( std::string_view str ) noexcept
+{
+	std::uint64_t hash = 14695981039346656037ull;
+	for( char c : str ) {
+		hash ^= static_cast<unsigned char>( c );
+		hash *= 1099511628211ull;
+	}
+	const auto ret = static_cast<std::size_t>( hash );
+	return ret == 0 ? 1 : ret;
+}
+
+} // namespace detail
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef CONST_STRING_DETAIL_PARALLEL_H
+#define CONST_STRING_DETAIL_PARALLEL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace detail {
+
+// number of threads to use, if the caller doesn't specify it (0)
+inline std::size_t default_thread_cnt( std::size_t requested ) noexcept
+{
+	if( requested != 0 ) {
+		return requested;
+	}
+	return std::max<std::size_t>( 1, std::thread::hardware_concurrency() );
+}
+
+/**
+ * Calls task( i ) for each i in [0, cnt), each on its own thread (task 0 runs on the calling thread), and waits for
+ * all of them to finish. If a thread can't be started, its task runs on the calling thread instead.
+ * task must not throw.
+ */
+template<class Task>
+void run_parallel( std::size_t cnt, const Task& task ) noexcept
+{
+	std::vector<std::thread> workers;
+	std::size_t              started = 1;
+	try {
+		workers.reserve( cnt );
+		for( ; started < cnt; ++started ) {
+			workers.emplace_back( [&task, started] { task( started ); } );
+		}
+	} catch( ... ) {
+		// out of threads or memory: do the rest ourselves
+	}
+
+	task( 0 );
+	for( std::size_t i = started; i < cnt; ++i ) {
+		task( i );
+	}
+	for( auto& w : workers ) {
+		w.join();
+	}
+}
+
+} // namespace detail
+
+#endif
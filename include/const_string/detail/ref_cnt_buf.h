@@ -1,205 +1,498 @@
 #ifndef CONST_STRING_DETAIL_REF_CNT_BUF_H
 #define CONST_STRING_DETAIL_REF_CNT_BUF_H
 
+// allocation scopes and arenas are built on std::pmr, which libstdc++ only ships since GCC 9
+#if defined( __has_include )
+#if !__has_include( <memory_resource> )
+#error "const_string requires <memory_resource> (e.g. GCC 9, Clang with libstdc++ 9 or libc++ 16, MSVC 2017 15.6)"
+#endif
+#endif
+
+#include "hash.h"
+#include "stats.h"
+
+#include <algorithm>
 #include <atomic>
 #include <cassert>
+#include <cstddef>
 #include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <memory_resource>
 #include <new>
+#include <stdexcept>
 #include <string_view>
 #include <utility>
 
-class const_string;
+template<class CntPolicy>
+class basic_const_string;
 
 namespace detail {
 
-#ifdef CONST_STRING_DEBUG_HOOKS
-struct Stats {
-	std::atomic_uint64_t total_cnt_accesses{0};
-	std::atomic_uint64_t total_allocs{0};
-	std::atomic_uint64_t current_allocs{0};
-	std::atomic_uint64_t inc_ref_cnt{0};
-	std::atomic_uint64_t dec_ref_cnt{0};
+struct defer_ref_cnt_tag_t {
+	constexpr defer_ref_cnt_tag_t( const defer_ref_cnt_tag_t& ) = default;
 
-	void inc_ref()
-	{
-		total_cnt_accesses.fetch_add( 1, std::memory_order_relaxed );
-		inc_ref_cnt.fetch_add( 1, std::memory_order_relaxed );
-	}
+private:
+	template<class CntPolicy>
+	friend class ::basic_const_string;
+	constexpr defer_ref_cnt_tag_t(){};
+};
 
-	void dec_ref()
-	{
-		total_cnt_accesses.fetch_add( 1, std::memory_order_relaxed );
-		dec_ref_cnt.fetch_add( 1, std::memory_order_relaxed );
-	}
+/**
+ * Describes where the memory for new buffers comes from.
+ * resource == nullptr means global new/delete. If monotonic is set, the memory is never returned to the resource
+ * when the last reference is dropped (the owner of the resource frees everything at once).
+ */
+struct allocation_source {
+	std::pmr::memory_resource* resource  = nullptr;
+	bool                       monotonic = false;
+};
 
-	void alloc()
-	{
-		total_allocs.fetch_add( 1, std::memory_order_relaxed );
-		current_allocs.fetch_add( 1, std::memory_order_relaxed );
-	}
+// source used by allocations on the current thread that don't specify one explicitly (see const_string_allocation_scope)
+inline allocation_source& current_allocation_source() noexcept
+{
+	static thread_local allocation_source source{};
+	return source;
+}
 
-	void dealloc() { current_allocs.fetch_sub( 1, std::memory_order_relaxed ); }
+/**
+ * Reference count policies. They determine the type of the counter and how it is modified.
+ * atomic_ref_cnt_policy is safe to use from multiple threads, local_ref_cnt_policy avoids the cost of atomic
+ * read-modify-write operations, but buffers using it must not be shared between threads.
+ */
+struct atomic_ref_cnt_policy {
+	using Cnt_t = std::atomic_int;
 
-	std::uint64_t get_total_cnt_accesses() const { return total_cnt_accesses.load( std::memory_order_relaxed ); };
-	std::uint64_t get_total_allocs() const { return total_allocs.load( std::memory_order_relaxed ); };
-	std::uint64_t get_current_allocs() const { return current_allocs.load( std::memory_order_relaxed ); };
-	std::uint64_t get_inc_ref_cnt() const { return inc_ref_cnt.load( std::memory_order_relaxed ); };
-	std::uint64_t get_dec_ref_cnt() const { return dec_ref_cnt.load( std::memory_order_relaxed ); };
+	static constexpr bool thread_safe = true;
 
-	constexpr Stats() noexcept = default;
-	Stats( const Stats& other )
-		: total_cnt_accesses( other.total_cnt_accesses.load( std::memory_order_relaxed ) )
-		, total_allocs( other.total_allocs.load( std::memory_order_relaxed ) )
-		, current_allocs( other.current_allocs.load( std::memory_order_relaxed ) )
-		, inc_ref_cnt( other.inc_ref_cnt.load( std::memory_order_relaxed ) )
-		, dec_ref_cnt( other.dec_ref_cnt.load( std::memory_order_relaxed ) )
-	{
-	}
-};
-#else
-struct Stats {
-	constexpr Stats() noexcept = default;
-
-	constexpr void inc_ref() noexcept {}
-	constexpr void dec_ref() noexcept {}
-	constexpr void alloc() noexcept {}
-	constexpr void dealloc() noexcept {}
-
-	constexpr std::uint64_t get_total_cnt_accesses() noexcept const { return 0; };
-	constexpr std::uint64_t get_total_allocs() const noexcept { return 0; };
-	constexpr std::uint64_t get_current_allocs() const noexcept { return 0; };
-	constexpr std::uint64_t get_inc_ref_cnt() const noexcept { return 0; };
-	constexpr std::uint64_t get_dec_ref_cnt() const noexcept { return 0; };
+	static int load( const Cnt_t& cnt ) noexcept { return cnt.load( std::memory_order_acquire ); }
+	static int add( Cnt_t& cnt, int n ) noexcept { return cnt.fetch_add( n, std::memory_order_relaxed ) + n; }
+	// returns true if the last reference was dropped
+	static bool release( Cnt_t& cnt ) noexcept { return cnt.fetch_sub( 1 ) == 1; }
 };
-#endif
 
-static Stats& stats()
-{
-	static Stats stats{};
-	return stats;
-}
+struct local_ref_cnt_policy {
+	using Cnt_t = int;
 
-struct defer_ref_cnt_tag_t {
-	constexpr defer_ref_cnt_tag_t( const defer_ref_cnt_tag_t& ) = default;
+	static constexpr bool thread_safe = false;
 
-private:
-	friend class ::const_string;
-	constexpr defer_ref_cnt_tag_t(){};
+	static int  load( const Cnt_t& cnt ) noexcept { return cnt; }
+	static int  add( Cnt_t& cnt, int n ) noexcept { return cnt += n; }
+	static bool release( Cnt_t& cnt ) noexcept { return --cnt == 0; }
 };
 
-class atomic_ref_cnt_buffer {
-	using Cnt_t = std::atomic_int;
+/**
+ * Control block at the start of each buffer. The character data follows directly after it.
+ *
+ * On 64 bit platforms it takes 24 bytes (32 with CONST_STRING_STATS), which every heap allocated string pays.
+ * Blocks that keep external characters alive (make_owner: adopt, map_file, strings taken over from std::string)
+ * extend it with a release function and the address of their payload (see owner_header). Strings of up to
+ * sso_capacity characters don't have a buffer at all. The memory rows of the benchmark show the size per string.
+ */
+template<class CntPolicy>
+struct basic_ref_cnt_header {
+	using Cnt_t = typename CntPolicy::Cnt_t;
+
+	// determines how the block is freed and where the payload is
+	enum class block_kind : unsigned char { new_delete, resource, arena, malloc, owner };
+
+	Cnt_t      cnt;
+	block_kind kind;
+	// false if the character behind the payload doesn't belong to the buffer (e.g. a memory mapped file)
+	bool payload_zero_terminated = true;
+	// number of characters managed by this buffer (without zero terminator). Unless this is an owner block, they
+	// start directly after the header
+	std::size_t payload_size = 0;
+	// hash of the payload. 0 if it hasn't been computed yet
+	std::atomic<std::size_t> hash{0};
+#ifdef CONST_STRING_STATS
+	// size of the memory block (only tracked for the statistics)
+	std::size_t alloc_size = 0;
+#endif
+};
+
+// see the comment above. Update it (and consider the cost for all strings) if the header grows
+#ifdef CONST_STRING_STATS
+static_assert( sizeof( void* ) != 8 || sizeof( basic_ref_cnt_header<atomic_ref_cnt_policy> ) <= 32 );
+#else
+static_assert( sizeof( void* ) != 8 || sizeof( basic_ref_cnt_header<atomic_ref_cnt_policy> ) <= 24 );
+#endif
 
-	static constexpr int required_space = (int)sizeof( Cnt_t );
+template<class CntPolicy>
+class basic_ref_cnt_buffer {
+	using Header_t = basic_ref_cnt_header<CntPolicy>;
+	using Kind     = typename Header_t::block_kind;
+
+	static constexpr std::size_t required_space = sizeof( Header_t );
+
+	// stored in front of the header for blocks that come from a std::pmr::memory_resource
+	struct resource_info {
+		std::pmr::memory_resource* resource;
+		std::size_t                size;
+	};
+	static_assert( sizeof( resource_info ) % alignof( Header_t ) == 0 );
+
+	// header of blocks that don't contain character data but an object that keeps the data alive
+	struct owner_header : Header_t {
+		// destroys the owner block
+		using release_fn_t = void ( * )( owner_header* ) noexcept;
+
+		release_fn_t release;
+		const char*  payload_data = nullptr;
+	};
+
+	template<class T>
+	struct owner_block : owner_header {
+		template<class... ARGS>
+		owner_block( ARGS&&... args )
+			: owner_header{{{1}, Kind::owner}, &_release_owner<T>}
+			, owner( std::forward<ARGS>( args )... )
+		{
+		}
+		T owner;
+	};
 
 public:
-	constexpr atomic_ref_cnt_buffer() noexcept = default;
+	constexpr basic_ref_cnt_buffer() noexcept = default;
 
-	constexpr atomic_ref_cnt_buffer( const atomic_ref_cnt_buffer& other, defer_ref_cnt_tag_t ) noexcept
-		: _cnt{other._cnt}
+	constexpr basic_ref_cnt_buffer( const basic_ref_cnt_buffer& other, defer_ref_cnt_tag_t ) noexcept
+		: _bits{other._bits}
 	{
 	}
 
-	explicit atomic_ref_cnt_buffer( int buffer_size )
+	// Longest buffer that can be allocated (std::length_error is thrown for longer ones)
+	static constexpr std::size_t max_size = static_cast<std::size_t>( std::numeric_limits<std::ptrdiff_t>::max() )
+											- sizeof( resource_info ) - required_space;
+
+	explicit basic_ref_cnt_buffer( std::size_t buffer_size )
 	{
-		stats().alloc();
+		_check_size( buffer_size );
 		auto data = new char[buffer_size + required_space];
-		_cnt      = new( data ) Cnt_t{1};
+		_set_header( new( data ) Header_t{{1}, Kind::new_delete} );
+		_track_alloc( buffer_size + required_space );
 
 		// TODO: Is this guaranteed by the standard?
-		assert( reinterpret_cast<char*>( _cnt ) == data );
+		assert( reinterpret_cast<char*>( _header() ) == data );
+	}
+
+	basic_ref_cnt_buffer( std::size_t buffer_size, allocation_source source )
+	{
+		if( source.resource == nullptr ) {
+			*this = basic_ref_cnt_buffer( buffer_size );
+			return;
+		}
+		_check_size( buffer_size );
+
+		const std::size_t size = sizeof( resource_info ) + required_space + buffer_size;
+		auto info = static_cast<resource_info*>( source.resource->allocate( size, alignof( Header_t ) ) );
+		new( info ) resource_info{source.resource, size};
+		_set_header( new( info + 1 ) Header_t{{1}, source.monotonic ? Kind::arena : Kind::resource} );
+		_track_alloc( size );
+	}
+
+	/**
+	 * Creates a buffer that doesn't hold any characters itself, but an object of type T (constructed from args)
+	 * that is destroyed when the last reference is dropped.
+	 */
+	template<class T, class... ARGS>
+	static basic_ref_cnt_buffer make_owner( ARGS&&... args )
+	{
+		basic_ref_cnt_buffer ret;
+		ret._set_header( new owner_block<T>( std::forward<ARGS>( args )... ) );
+		ret._track_alloc( sizeof( owner_block<T> ) );
+		return ret;
 	}
 
-	atomic_ref_cnt_buffer( const atomic_ref_cnt_buffer& other ) noexcept
-		: _cnt{other._cnt}
+	// Returns the object held by a buffer created via make_owner<T> or nullptr, if this buffer is something else
+	template<class T>
+	const T* get_owner() const noexcept
+	{
+		if( !_header() || _header()->kind != Kind::owner
+			|| static_cast<const owner_header*>( _header() )->release != &_release_owner<T> ) {
+			return nullptr;
+		}
+		return &static_cast<const owner_block<T>*>( _header() )->owner;
+	}
+
+	/**
+	 * Growable blocks are used to fill a buffer incrementally (see basic_const_string_builder). They are allocated with
+	 * malloc, so they can be resized with realloc, and don't contain a header until they get adopted.
+	 * The characters start at block + header_size.
+	 */
+	static constexpr std::size_t header_size = required_space;
+
+	static char* reallocate_growable( char* block, std::size_t buffer_size )
+	{
+		_check_size( buffer_size );
+		auto ret = static_cast<char*>( std::realloc( block, buffer_size + required_space ) );
+		if( ret == nullptr ) {
+			throw std::bad_alloc{};
+		}
+		return ret;
+	}
+
+	static void free_growable( char* block ) noexcept { std::free( block ); }
+
+	// Takes ownership of a growable block of buffer_size characters. The block must not be resized or freed afterwards
+	static basic_ref_cnt_buffer adopt_growable( char* block, std::size_t buffer_size ) noexcept
+	{
+		basic_ref_cnt_buffer ret;
+		ret._set_header( new( block ) Header_t{{1}, Kind::malloc} );
+		ret._track_alloc( buffer_size + required_space );
+		return ret;
+	}
+
+	basic_ref_cnt_buffer( const basic_ref_cnt_buffer& other ) noexcept
+		: _bits{other._bits}
 	{
 		_incref();
 	}
 
-	atomic_ref_cnt_buffer( atomic_ref_cnt_buffer&& other ) noexcept
-		: _cnt{std::exchange( other._cnt, nullptr )}
+	basic_ref_cnt_buffer( basic_ref_cnt_buffer&& other ) noexcept
+		: _bits{std::exchange( other._bits, 0 )}
 	{
 	}
 
-	atomic_ref_cnt_buffer& operator=( const atomic_ref_cnt_buffer& other ) noexcept
+	basic_ref_cnt_buffer& operator=( const basic_ref_cnt_buffer& other ) noexcept
 	{
 		// inc before dec to protect against dropping in self assignment
 		other._incref();
 		_decref();
-		_cnt = other._cnt;
+		_bits = other._bits;
 
 		return *this;
 	}
 
-	atomic_ref_cnt_buffer& operator=( atomic_ref_cnt_buffer&& other ) noexcept
+	basic_ref_cnt_buffer& operator=( basic_ref_cnt_buffer&& other ) noexcept
 	{
 		assert( this != &other && "Move assignment to self is not allowed" );
 		_decref();
-		_cnt = std::exchange( other._cnt, nullptr );
+		_bits = std::exchange( other._bits, 0 );
 		return *this;
 	}
 
-	~atomic_ref_cnt_buffer() { _decref(); }
+	~basic_ref_cnt_buffer() { _decref(); }
 
-	char* get() noexcept { return reinterpret_cast<char*>( _cnt ) + sizeof( Cnt_t ); }
+	char* get() noexcept { return reinterpret_cast<char*>( _header() ) + required_space; }
 
-	friend void swap( atomic_ref_cnt_buffer& l, atomic_ref_cnt_buffer& r ) noexcept { std::swap( l._cnt, r._cnt ); }
+	explicit operator bool() const noexcept { return _header() != nullptr; }
+
+	std::string_view payload() const noexcept
+	{
+		return _header() ? std::string_view( _payload_data(), _header()->payload_size ) : std::string_view{};
+	}
+
+	bool payload_zero_terminated() const noexcept { return _header() && _header()->payload_zero_terminated; }
+
+	// Except for owner blocks, the payload has to start at get()
+	void set_payload( std::string_view payload, bool zero_terminated = true ) noexcept
+	{
+		assert( _header() );
+		if( _header()->kind == Kind::owner ) {
+			static_cast<owner_header*>( _header() )->payload_data = payload.data();
+		}
+		assert( payload.data() == _payload_data() );
+		_header()->payload_size            = payload.size();
+		_header()->payload_zero_terminated = zero_terminated;
+		_header()->hash.store( 0, std::memory_order_relaxed );
+	}
+
+	// returns the hash of the payload, computing and caching it on first use
+	std::size_t payload_hash() const noexcept
+	{
+		assert( _header() );
+		auto hash = _header()->hash.load( std::memory_order_relaxed );
+		if( hash == 0 ) {
+			// benign race: concurrent calls compute and store the same value
+			hash = string_hash( payload() );
+			_header()->hash.store( hash, std::memory_order_relaxed );
+		}
+		return hash;
+	}
+
+	friend void swap( basic_ref_cnt_buffer& l, basic_ref_cnt_buffer& r ) noexcept
+	{
+		std::swap( l._bits, r._bits );
+	}
 
 	int get_ref_cnt() const
 	{
-		if( !_cnt ) {
+		if( !_header() ) {
 			return 0;
 		}
-		return _cnt->load( std::memory_order_acquire );
+		return CntPolicy::load( _header()->cnt );
 	}
 
 	int add_ref_cnt( int cnt ) const
 	{
-		if( !_cnt ) {
-			return 0;
+		if( !_is_counted() ) {
+			return get_ref_cnt();
 		}
 		stats().inc_ref();
-		return _cnt->fetch_add( cnt, std::memory_order_relaxed ) + cnt;
+		return CntPolicy::add( _header()->cnt, cnt );
+	}
+
+	/**
+	 * Turns this handle into a handle to an immortal buffer: The reference it owns is never released, so the buffer
+	 * is never freed, and neither this handle nor copies made from it afterwards modify the reference count.
+	 */
+	void make_immortal() noexcept
+	{
+		if( _bits != 0 ) {
+			_bits |= immortal_bit;
+		}
 	}
 
+	bool is_immortal() const noexcept { return ( _bits & immortal_bit ) != 0; }
+
 private:
+	static void _check_size( std::size_t buffer_size )
+	{
+		if( buffer_size > max_size ) {
+			throw std::length_error( "const_string: String too long" );
+		}
+	}
+
 	void _decref() const noexcept
 	{
-		if( _cnt ) {
+		if( _is_counted() ) {
 			stats().dec_ref();
-			if( _cnt->fetch_sub( 1 ) == 1 ) {
-				stats().dealloc();
-				_cnt->~Cnt_t();
-				delete[]( reinterpret_cast<char*>( _cnt ) );
+			Header_t* const header = _header();
+			if( CntPolicy::release( header->cnt ) ) {
+				stats().dealloc( _alloc_size() );
+				_release( header );
 			}
 		}
 	}
 
+	void _track_alloc( std::size_t size ) noexcept
+	{
+		stats().alloc( size );
+#ifdef CONST_STRING_STATS
+		_header()->alloc_size = size;
+#endif
+	}
+
+	std::size_t _alloc_size() const noexcept
+	{
+#ifdef CONST_STRING_STATS
+		return _header()->alloc_size;
+#else
+		return 0;
+#endif
+	}
+
 	void _incref() const noexcept
 	{
-		if( _cnt ) {
+		if( _is_counted() ) {
 			stats().inc_ref();
-			_cnt->fetch_add( 1, std::memory_order_relaxed );
+			CntPolicy::add( _header()->cnt, 1 );
+		}
+	}
+
+	// frees the memory block the header is part of
+	static void _release( Header_t* header ) noexcept
+	{
+		switch( header->kind ) {
+			case Kind::new_delete:
+				header->~Header_t();
+				delete[]( reinterpret_cast<char*>( header ) );
+				break;
+			case Kind::resource: {
+				header->~Header_t();
+				auto info = reinterpret_cast<resource_info*>( header ) - 1;
+				info->resource->deallocate( info, info->size, alignof( Header_t ) );
+				break;
+			}
+			case Kind::arena:
+				// the owner of the resource frees everything at once
+				break;
+			case Kind::malloc:
+				header->~Header_t();
+				std::free( header );
+				break;
+			case Kind::owner: {
+				auto owner = static_cast<owner_header*>( header );
+				owner->release( owner );
+				break;
+			}
+		}
+	}
+
+	template<class T>
+	static void _release_owner( owner_header* header ) noexcept
+	{
+		delete static_cast<owner_block<T>*>( header );
+	}
+
+	const char* _payload_data() const noexcept
+	{
+		if( _header()->kind == Kind::owner ) {
+			return static_cast<const owner_header*>( _header() )->payload_data;
 		}
+		return reinterpret_cast<const char*>( _header() ) + required_space;
 	}
 
-	Cnt_t* _cnt = nullptr;
+	static constexpr std::uintptr_t immortal_bit = 1;
+	static_assert( alignof( Header_t ) > immortal_bit );
+
+	Header_t* _header() const noexcept { return reinterpret_cast<Header_t*>( _bits & ~immortal_bit ); }
+
+	void _set_header( Header_t* header ) noexcept { _bits = reinterpret_cast<std::uintptr_t>( header ); }
+
+	// whether this handle takes part in the reference counting (false for immortal and empty ones)
+	bool _is_counted() const noexcept { return _bits != 0 && ( _bits & immortal_bit ) == 0; }
+
+	// address of the header. The lowest bit is set for handles to immortal buffers (the header is suitably aligned)
+	std::uintptr_t _bits = 0;
 };
 
-struct AllocResult {
-	char*                 data;
-	atomic_ref_cnt_buffer handle;
+using atomic_ref_cnt_buffer = basic_ref_cnt_buffer<atomic_ref_cnt_policy>;
+using local_ref_cnt_buffer  = basic_ref_cnt_buffer<local_ref_cnt_policy>;
+
+template<class CntPolicy>
+struct basic_alloc_result {
+	char*                           data;
+	basic_ref_cnt_buffer<CntPolicy> handle;
 };
 
-inline AllocResult allocate_null_terminated_char_buffer( int size )
+using AllocResult = basic_alloc_result<atomic_ref_cnt_policy>;
+
+// owner of a buffer that was adopted by a const_string (see basic_const_string::adopt)
+template<class Deleter>
+struct adopted_buffer {
+	adopted_buffer( char* data, Deleter deleter )
+		: data( data )
+		, deleter( std::move( deleter ) )
+	{
+	}
+	adopted_buffer( const adopted_buffer& ) = delete;
+	adopted_buffer& operator=( const adopted_buffer& ) = delete;
+
+	~adopted_buffer() { deleter( data ); }
+
+	char*   data;
+	Deleter deleter;
+};
+
+template<class CntPolicy = atomic_ref_cnt_policy>
+basic_alloc_result<CntPolicy> allocate_null_terminated_char_buffer( std::size_t size, allocation_source source )
 {
-	atomic_ref_cnt_buffer handle( size + 1 );
-	auto                  data = handle.get();
+	// size + 1 mustn't wrap around (sizes above max_size are rejected by the constructor)
+	basic_ref_cnt_buffer<CntPolicy> handle( std::min( size, basic_ref_cnt_buffer<CntPolicy>::max_size ) + 1, source );
+	auto                            data = handle.get();
 
 	data[size] = '\0'; // zero terminate
+	handle.set_payload( std::string_view( data, size ) );
 	return {data, std::move( handle )};
 }
 
+template<class CntPolicy = atomic_ref_cnt_policy>
+basic_alloc_result<CntPolicy> allocate_null_terminated_char_buffer( std::size_t size )
+{
+	return allocate_null_terminated_char_buffer<CntPolicy>( size, current_allocation_source() );
+}
+
 inline constexpr std::string_view getEmptyZeroTerminatedStringView()
 {
 	return std::string_view{""};
@@ -0,0 +1,294 @@
+#ifndef CONST_STRING_DETAIL_STATS_H
+#define CONST_STRING_DETAIL_STATS_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// CONST_STRING_STATS enables the runtime statistics (cheap enough for release builds). The debug hooks imply them.
+#if defined( CONST_STRING_DEBUG_HOOKS ) && !defined( CONST_STRING_STATS )
+#define CONST_STRING_STATS
+#endif
+
+/**
+ * Copy of the runtime statistics at one point in time (see get_const_string_stats). All values are 0 unless
+ * CONST_STRING_STATS is defined. Values that are modified concurrently with taking the snapshot might be slightly
+ * inconsistent with each other.
+ *
+ * NOTE: There is deliberately no gauge of the waste currently pinned by substrings (which would require tracking
+ * every string), so it isn't exported by for_each either. basic_const_string::pinned_waste computes it on demand for
+ * a given collection of strings, e.g. to report it next to these values.
+ */
+struct const_string_stats {
+	static constexpr int histogram_buckets = 32;
+
+	std::uint64_t total_allocs    = 0;
+	std::int64_t  current_allocs  = 0;
+	std::uint64_t allocated_bytes = 0;
+	std::int64_t  live_bytes      = 0;
+	// sampled from time to time, so short peaks might be missed
+	std::int64_t  peak_live_bytes = 0;
+	std::uint64_t avoided_allocs  = 0;
+
+	std::uint64_t inc_ref_cnt        = 0;
+	std::uint64_t dec_ref_cnt        = 0;
+	std::uint64_t total_cnt_accesses = 0;
+
+	std::uint64_t concat_calls  = 0;
+	std::uint64_t split_calls   = 0;
+	std::uint64_t unshare_calls = 0;
+
+	// only count waste released by shrink_if_wasteful / compact (see the note above)
+	std::uint64_t compacted_strings = 0;
+	std::uint64_t released_waste    = 0;
+
+	// alloc_size_histogram[i] counts the allocations of size [2^(i-1), 2^i) bytes. The last bucket also contains all
+	// bigger allocations
+	std::array<std::uint64_t, histogram_buckets> alloc_size_histogram{};
+
+	// calls visitor( name, value ) for each scalar value, e.g. to export them to a metrics system
+	template<class Visitor>
+	void for_each( Visitor&& visitor ) const
+	{
+		visitor( "total_allocs", total_allocs );
+		visitor( "current_allocs", current_allocs );
+		visitor( "allocated_bytes", allocated_bytes );
+		visitor( "live_bytes", live_bytes );
+		visitor( "peak_live_bytes", peak_live_bytes );
+		visitor( "avoided_allocs", avoided_allocs );
+		visitor( "inc_ref_cnt", inc_ref_cnt );
+		visitor( "dec_ref_cnt", dec_ref_cnt );
+		visitor( "total_cnt_accesses", total_cnt_accesses );
+		visitor( "concat_calls", concat_calls );
+		visitor( "split_calls", split_calls );
+		visitor( "unshare_calls", unshare_calls );
+		visitor( "compacted_strings", compacted_strings );
+		visitor( "released_waste", released_waste );
+	}
+};
+
+namespace detail {
+
+#ifdef CONST_STRING_STATS
+/**
+ * The counters are distributed over several shards (each thread uses one of them), so threads don't have to
+ * modify the same cache line. Reading a value sums up all shards.
+ */
+class Stats {
+public:
+	Stats() noexcept = default;
+	Stats( const Stats& other ) noexcept
+	{
+		for( std::size_t s = 0; s < shard_cnt; ++s ) {
+			for( int i = 0; i < counter_cnt; ++i ) {
+				_shards[s].counters[i].store( other._shards[s].counters[i].load( std::memory_order_relaxed ),
+											  std::memory_order_relaxed );
+			}
+			for( int i = 0; i < const_string_stats::histogram_buckets; ++i ) {
+				_shards[s].histogram[i].store( other._shards[s].histogram[i].load( std::memory_order_relaxed ),
+											   std::memory_order_relaxed );
+			}
+		}
+		_peak_live_bytes.store( other._peak_live_bytes.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+	}
+
+	void inc_ref() noexcept
+	{
+		Shard& shard = _local_shard();
+		shard.add( total_cnt_accesses, 1 );
+		shard.add( inc_ref_cnt, 1 );
+	}
+
+	void dec_ref() noexcept
+	{
+		Shard& shard = _local_shard();
+		shard.add( total_cnt_accesses, 1 );
+		shard.add( dec_ref_cnt, 1 );
+	}
+
+	void alloc( std::size_t bytes ) noexcept
+	{
+		Shard&     shard = _local_shard();
+		const auto cnt   = shard.add( total_allocs, 1 );
+		shard.add( current_allocs, 1 );
+		shard.add( allocated_bytes, static_cast<std::int64_t>( bytes ) );
+		shard.add( live_bytes, static_cast<std::int64_t>( bytes ) );
+		shard.histogram[_bucket( bytes )].fetch_add( 1, std::memory_order_relaxed );
+
+		if( cnt % peak_sample_interval == 0 || bytes >= large_alloc_size ) {
+			_sample_peak();
+		}
+	}
+
+	void dealloc( std::size_t bytes ) noexcept
+	{
+		Shard& shard = _local_shard();
+		shard.add( current_allocs, -1 );
+		shard.add( live_bytes, -static_cast<std::int64_t>( bytes ) );
+	}
+
+	void sso() noexcept { _local_shard().add( avoided_allocs, 1 ); }
+
+	void concat_call() noexcept { _local_shard().add( concat_calls, 1 ); }
+	void split_call() noexcept { _local_shard().add( split_calls, 1 ); }
+	void unshare_call() noexcept { _local_shard().add( unshare_calls, 1 ); }
+
+	// a string that kept wasted_bytes of its buffer alive got replaced by a copy (see shrink_if_wasteful)
+	void compacted( std::uint64_t wasted_bytes ) noexcept
+	{
+		Shard& shard = _local_shard();
+		shard.add( compacted_strings, 1 );
+		shard.add( released_waste, static_cast<std::int64_t>( wasted_bytes ) );
+	}
+
+	std::uint64_t get_total_cnt_accesses() const noexcept { return _sum( total_cnt_accesses ); }
+	std::uint64_t get_total_allocs() const noexcept { return _sum( total_allocs ); }
+	std::uint64_t get_current_allocs() const noexcept { return _sum( current_allocs ); }
+	std::uint64_t get_inc_ref_cnt() const noexcept { return _sum( inc_ref_cnt ); }
+	std::uint64_t get_dec_ref_cnt() const noexcept { return _sum( dec_ref_cnt ); }
+	std::uint64_t get_avoided_allocs() const noexcept { return _sum( avoided_allocs ); }
+	std::uint64_t get_compacted_strings() const noexcept { return _sum( compacted_strings ); }
+	std::uint64_t get_released_waste() const noexcept { return _sum( released_waste ); }
+
+	const_string_stats snapshot() noexcept
+	{
+		_sample_peak();
+
+		const_string_stats ret;
+		ret.total_allocs       = _sum( total_allocs );
+		ret.current_allocs     = _sum( current_allocs );
+		ret.allocated_bytes    = _sum( allocated_bytes );
+		ret.live_bytes         = _sum( live_bytes );
+		ret.peak_live_bytes    = _peak_live_bytes.load( std::memory_order_relaxed );
+		ret.avoided_allocs     = _sum( avoided_allocs );
+		ret.inc_ref_cnt        = _sum( inc_ref_cnt );
+		ret.dec_ref_cnt        = _sum( dec_ref_cnt );
+		ret.total_cnt_accesses = _sum( total_cnt_accesses );
+		ret.concat_calls       = _sum( concat_calls );
+		ret.split_calls        = _sum( split_calls );
+		ret.unshare_calls      = _sum( unshare_calls );
+		ret.compacted_strings  = _sum( compacted_strings );
+		ret.released_waste     = _sum( released_waste );
+		for( const auto& shard : _shards ) {
+			for( int i = 0; i < const_string_stats::histogram_buckets; ++i ) {
+				ret.alloc_size_histogram[i] += shard.histogram[i].load( std::memory_order_relaxed );
+			}
+		}
+		return ret;
+	}
+
+private:
+	enum Counter {
+		total_cnt_accesses,
+		inc_ref_cnt,
+		dec_ref_cnt,
+		total_allocs,
+		current_allocs,
+		allocated_bytes,
+		live_bytes,
+		avoided_allocs,
+		concat_calls,
+		split_calls,
+		unshare_calls,
+		compacted_strings,
+		released_waste,
+		counter_cnt
+	};
+
+	static constexpr std::size_t shard_cnt            = 16;
+	static constexpr std::int64_t peak_sample_interval = 64;
+	static constexpr std::size_t large_alloc_size     = 64 * 1024;
+
+	struct alignas( 64 ) Shard {
+		std::array<std::atomic<std::int64_t>, counter_cnt>                         counters{};
+		std::array<std::atomic<std::uint64_t>, const_string_stats::histogram_buckets> histogram{};
+
+		// returns the new value
+		std::int64_t add( Counter c, std::int64_t n ) noexcept
+		{
+			return counters[c].fetch_add( n, std::memory_order_relaxed ) + n;
+		}
+	};
+
+	static int _bucket( std::size_t bytes ) noexcept
+	{
+		int bucket = 0;
+#if defined( __GNUC__ )
+		bucket = bytes == 0 ? 0 : 64 - __builtin_clzll( bytes );
+#else
+		for( ; bytes != 0; bytes >>= 1 ) {
+			bucket++;
+		}
+#endif
+		return bucket < const_string_stats::histogram_buckets ? bucket : const_string_stats::histogram_buckets - 1;
+	}
+
+	Shard& _local_shard() noexcept
+	{
+		static std::atomic<std::size_t> next_shard{0};
+		static thread_local std::size_t idx = next_shard.fetch_add( 1, std::memory_order_relaxed ) % shard_cnt;
+		return _shards[idx];
+	}
+
+	std::int64_t _sum( Counter c ) const noexcept
+	{
+		std::int64_t sum = 0;
+		for( const auto& shard : _shards ) {
+			sum += shard.counters[c].load( std::memory_order_relaxed );
+		}
+		return sum;
+	}
+
+	void _sample_peak() noexcept
+	{
+		const auto current = _sum( live_bytes );
+		auto       peak    = _peak_live_bytes.load( std::memory_order_relaxed );
+		while( current > peak && !_peak_live_bytes.compare_exchange_weak( peak, current, std::memory_order_relaxed ) ) {
+		}
+	}
+
+	std::array<Shard, shard_cnt> _shards{};
+	std::atomic<std::int64_t>    _peak_live_bytes{0};
+};
+#else
+struct Stats {
+	constexpr Stats() noexcept = default;
+
+	constexpr void inc_ref() noexcept {}
+	constexpr void dec_ref() noexcept {}
+	constexpr void alloc( std::size_t ) noexcept {}
+	constexpr void dealloc( std::size_t ) noexcept {}
+	constexpr void sso() noexcept {}
+	constexpr void concat_call() noexcept {}
+	constexpr void split_call() noexcept {}
+	constexpr void unshare_call() noexcept {}
+	constexpr void compacted( std::uint64_t ) noexcept {}
+
+	constexpr std::uint64_t get_total_cnt_accesses() const noexcept { return 0; };
+	constexpr std::uint64_t get_total_allocs() const noexcept { return 0; };
+	constexpr std::uint64_t get_current_allocs() const noexcept { return 0; };
+	constexpr std::uint64_t get_inc_ref_cnt() const noexcept { return 0; };
+	constexpr std::uint64_t get_dec_ref_cnt() const noexcept { return 0; };
+	constexpr std::uint64_t get_avoided_allocs() const noexcept { return 0; };
+	constexpr std::uint64_t get_compacted_strings() const noexcept { return 0; };
+	constexpr std::uint64_t get_released_waste() const noexcept { return 0; };
+
+	const_string_stats snapshot() const noexcept { return {}; }
+};
+#endif
+
+inline Stats& stats()
+{
+	static Stats stats{};
+	return stats;
+}
+
+} // namespace detail
+
+inline const_string_stats get_const_string_stats()
+{
+	return detail::stats().snapshot();
+}
+
+#endif
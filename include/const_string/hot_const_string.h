@@ -0,0 +1,75 @@
+#ifndef CONST_STRING_HOT_CONST_STRING_H
+#define CONST_STRING_HOT_CONST_STRING_H
+
+#include "const_string.h"
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/**
+ * Holds a const_string that gets copied a lot on many threads (e.g. a config value or tenant name). Copying a
+ * const_string modifies its atomic reference count, so if many threads do that at the same time, the cache line
+ * holding the counter bounces between the cores.
+ *
+ * local() returns a local_const_string that shares the buffer through a proxy, which is created only once per thread
+ * (a single atomic increment) and cached in thread local storage. Copies of it only modify the proxy's plain int
+ * counter, so threads don't interfere with each other.
+ *
+ * NOTE: A thread's cached proxy keeps the buffer alive until the thread calls local() again after the
+ * hot_const_string has been destroyed (or until the thread exits).
+ */
+class hot_const_string {
+public:
+	hot_const_string()
+		: hot_const_string( const_string{} )
+	{
+	}
+
+	explicit hot_const_string( const_string str )
+		: _state( std::make_shared<const const_string>( std::move( str ) ) )
+	{
+	}
+
+	// the string itself. Copying it modifies the shared (atomic) reference count
+	const const_string& shared() const noexcept { return *_state; }
+
+	// Returns a copy for use on the calling thread only (it must not be passed to other threads)
+	local_const_string local() const
+	{
+		auto& cache = _thread_cache();
+		// Comparing the address is enough (and doesn't touch the shared control block): As the state is allocated by
+		// make_shared, the weak_ptr in the entry keeps its memory from being reused by another hot_const_string
+		for( const auto& entry : cache ) {
+			if( entry.key == _state.get() ) {
+				return entry.proxy;
+			}
+		}
+
+		// first use on this thread: remove entries of destroyed hot strings and create a new proxy
+		cache.erase( std::remove_if( cache.begin(), cache.end(), []( const Entry& e ) { return e.state.expired(); } ),
+					 cache.end() );
+		cache.push_back( Entry{_state.get(), _state, local_const_string( *_state )} );
+		return cache.back().proxy;
+	}
+
+	operator const const_string&() const noexcept { return *_state; }
+
+private:
+	struct Entry {
+		const const_string*               key;
+		std::weak_ptr<const const_string> state;
+		local_const_string                proxy;
+	};
+
+	static std::vector<Entry>& _thread_cache()
+	{
+		static thread_local std::vector<Entry> cache;
+		return cache;
+	}
+
+	std::shared_ptr<const const_string> _state;
+};
+
+#endif
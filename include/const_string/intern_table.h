@@ -0,0 +1,159 @@
+#ifndef CONST_STRING_INTERN_TABLE_H
+#define CONST_STRING_INTERN_TABLE_H
+
+#include "const_string.h"
+
+#include <array>
+#include <limits>
+#include <mutex>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+
+/**
+ * Thread safe table that maps strings to a canonical const_string, so that equal strings share a single buffer.
+ * Strings returned for equal input point to the same characters (a.data() == b.data()), so interned strings can be
+ * compared by pointer.
+ *
+ * The table is split into shards, each protected by its own reader/writer lock. Lookups of existing entries only take
+ * a shared lock, so concurrent lookups don't block each other.
+ */
+class const_string_intern_table {
+public:
+	enum class Eviction {
+		Manual,   // entries are only removed by calling evict_unused()
+		Automatic // a shard evicts unused entries whenever its size has doubled since the last eviction
+	};
+
+	explicit const_string_intern_table( Eviction eviction = Eviction::Manual )
+		: _eviction( eviction )
+	{
+	}
+
+	const_string_intern_table( const const_string_intern_table& ) = delete;
+	const_string_intern_table& operator=( const const_string_intern_table& ) = delete;
+
+	const_string intern( std::string_view str )
+	{
+		if( str.empty() ) {
+			return const_string{""};
+		}
+		const Key_t key{str, detail::string_hash( str )};
+		Shard&      shard = _shards[_shard_index( key.hash )];
+
+		{
+			std::shared_lock<std::shared_mutex> lock( shard.mutex );
+			auto                                it = shard.map.find( key );
+			if( it != shard.map.end() ) {
+				return it->second;
+			}
+		}
+
+		std::unique_lock<std::shared_mutex> lock( shard.mutex );
+		// someone else might have inserted the string while we didn't hold the lock
+		auto it = shard.map.find( key );
+		if( it != shard.map.end() ) {
+			return it->second;
+		}
+
+		if( _eviction == Eviction::Automatic && shard.map.size() >= 2 * shard.size_after_eviction
+			&& shard.map.size() >= min_eviction_size ) {
+			_evict_unused( shard );
+		}
+
+		// always allocate a buffer (no small string optimization), so all copies share the same characters. It comes
+		// from the heap, even inside an allocation scope, as the table might outlive the scope's memory resource
+		auto buffer = detail::allocate_null_terminated_char_buffer( str.size(), detail::allocation_source{} );
+		std::copy_n( str.data(), str.size(), buffer.data );
+		const auto interned
+			= detail::string_from_buffer::make<const_string>( std::move( buffer.handle ), buffer.data, str.size() );
+
+		shard.map.emplace( Key_t{interned, key.hash}, interned );
+		return interned;
+	}
+
+	// removes all entries that are not referenced from outside of the table. Returns the number of removed entries
+	std::size_t evict_unused()
+	{
+		std::size_t cnt = 0;
+		for( auto& shard : _shards ) {
+			std::unique_lock<std::shared_mutex> lock( shard.mutex );
+			cnt += _evict_unused( shard );
+		}
+		return cnt;
+	}
+
+	std::size_t size() const
+	{
+		std::size_t cnt = 0;
+		for( auto& shard : _shards ) {
+			std::shared_lock<std::shared_mutex> lock( shard.mutex );
+			cnt += shard.map.size();
+		}
+		return cnt;
+	}
+
+private:
+	static constexpr int         shard_bits        = 6;
+	static constexpr std::size_t shard_count       = std::size_t( 1 ) << shard_bits;
+	static constexpr std::size_t min_eviction_size = 64;
+
+	// the shards' maps use the low bits of the hash (MSVC's unordered_map masks them), so the shard is picked by the
+	// high bits. Otherwise all keys of a shard would end up in the same 1/shard_count of its buckets
+	static std::size_t _shard_index( std::size_t hash ) noexcept
+	{
+		return hash >> ( std::numeric_limits<std::size_t>::digits - shard_bits );
+	}
+
+	// the hash is stored in the key, so it only has to be computed once per lookup
+	struct Key_t {
+		std::string_view str;
+		std::size_t      hash;
+
+		friend bool operator==( const Key_t& l, const Key_t& r ) noexcept { return l.str == r.str; }
+	};
+
+	struct KeyHash {
+		std::size_t operator()( const Key_t& key ) const noexcept { return key.hash; }
+	};
+
+	struct alignas( 64 ) Shard {
+		mutable std::shared_mutex                        mutex;
+		std::unordered_map<Key_t, const_string, KeyHash> map;
+		std::size_t                                      size_after_eviction = 0;
+	};
+
+	// expects the shard to be locked exclusively
+	static std::size_t _evict_unused( Shard& shard )
+	{
+		std::size_t cnt = 0;
+		for( auto it = shard.map.begin(); it != shard.map.end(); ) {
+			// new references can only be created via the table, so 1 means nobody else is using this string
+			if( it->second.get_ref_cnt() == 1 ) {
+				it = shard.map.erase( it );
+				cnt++;
+			} else {
+				++it;
+			}
+		}
+		shard.size_after_eviction = shard.map.size();
+		return cnt;
+	}
+
+	const Eviction                 _eviction;
+	std::array<Shard, shard_count> _shards;
+};
+
+inline const_string_intern_table& global_intern_table()
+{
+	static const_string_intern_table table{};
+	return table;
+}
+
+// Returns the canonical const_string for str from the global intern table
+inline const_string intern( std::string_view str )
+{
+	return global_intern_table().intern( str );
+}
+
+#endif
@@ -0,0 +1,139 @@
+#ifndef CONST_STRING_KEYWORD_SWITCH_H
+#define CONST_STRING_KEYWORD_SWITCH_H
+
+#include "const_string.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+
+namespace detail {
+// log2 of the minimal size of the hash table of a keyword_switch (at least 2 slots per keyword)
+constexpr int keyword_table_bits( std::size_t keyword_cnt ) noexcept
+{
+	int bits = 1;
+	while( ( std::size_t( 1 ) << bits ) < 2 * keyword_cnt ) {
+		bits++;
+	}
+	return bits;
+}
+} // namespace detail
+
+/**
+ * Maps a string to the index of the matching keyword out of a fixed set. The lookup uses a perfect hash table that is
+ * built at compile time, so it hashes the string once (with the hash function of const_string, so the cached hash of
+ * a const_string is reused) and does at most one string comparison.
+ *
+ *   constexpr auto methods = make_keyword_switch( "GET", "POST", "PUT" );
+ *   switch( methods.find( token ) ) {
+ *       case methods.index_of( "GET" ): ...
+ *       case methods.index_of( "POST" ): ...
+ *       case methods.not_found: ...
+ *   }
+ */
+template<std::size_t N>
+class keyword_switch {
+	static_assert( N > 0, "A keyword_switch needs at least one keyword" );
+
+public:
+	static constexpr int not_found = -1;
+
+	constexpr explicit keyword_switch( const std::array<const_string_literal, N>& keywords )
+		: _keywords( keywords )
+	{
+		for( std::size_t i = 0; i < N; ++i ) {
+			for( std::size_t k = 0; k < i; ++k ) {
+				if( _keywords[k].view() == _keywords[i].view() ) {
+					throw std::invalid_argument( "Duplicate keyword in keyword_switch" );
+				}
+			}
+		}
+
+		for( int bits = min_bits; bits <= max_bits; ++bits ) {
+			for( std::uint64_t seed = 0; seed < max_seeds; ++seed ) {
+				if( _try_build( bits, seed ) ) {
+					return;
+				}
+			}
+		}
+		throw std::logic_error( "No perfect hash found for the keywords" );
+	}
+
+	// index of the keyword that is equal to str or not_found
+	constexpr int find( std::string_view str ) const noexcept { return _find( str, detail::string_hash( str ) ); }
+
+	template<class CntPolicy>
+	int find( const basic_const_string<CntPolicy>& str ) const noexcept
+	{
+		return _find( str, str.hash() );
+	}
+
+	// Like find, but throws if keyword is not part of the set (so an invalid case label doesn't compile)
+	constexpr int index_of( std::string_view keyword ) const
+	{
+		const int idx = find( keyword );
+		if( idx == not_found ) {
+			throw std::invalid_argument( "Not a keyword of this keyword_switch" );
+		}
+		return idx;
+	}
+
+	constexpr const_string_literal operator[]( std::size_t idx ) const noexcept { return _keywords[idx]; }
+
+	static constexpr std::size_t size() noexcept { return N; }
+
+private:
+	static constexpr std::uint64_t max_seeds = 1024;
+	static constexpr int           min_bits  = detail::keyword_table_bits( N );
+	// if no seed works, the table gets bigger (up to 8 times the minimal size)
+	static constexpr int         max_bits       = min_bits + 3;
+	static constexpr std::size_t max_table_size = std::size_t( 1 ) << max_bits;
+
+	constexpr std::size_t _slot( std::size_t hash ) const noexcept
+	{
+		return static_cast<std::size_t>( ( ( static_cast<std::uint64_t>( hash ) ^ _seed ) * 0x9E3779B97F4A7C15ull )
+										 >> ( 64 - _bits ) );
+	}
+
+	constexpr bool _try_build( int bits, std::uint64_t seed ) noexcept
+	{
+		_bits = bits;
+		_seed = seed;
+		for( auto& slot : _slots ) {
+			slot = not_found;
+		}
+		for( std::size_t i = 0; i < N; ++i ) {
+			auto& slot = _slots[_slot( _keywords[i].hash() )];
+			if( slot != not_found ) {
+				return false;
+			}
+			slot = static_cast<int>( i );
+		}
+		return true;
+	}
+
+	constexpr int _find( std::string_view str, std::size_t hash ) const noexcept
+	{
+		const int idx = _slots[_slot( hash )];
+		if( idx == not_found || _keywords[idx].hash() != hash || _keywords[idx].view() != str ) {
+			return not_found;
+		}
+		return idx;
+	}
+
+	std::array<const_string_literal, N> _keywords;
+	std::array<int, max_table_size>     _slots{};
+	int                                 _bits = 1;
+	std::uint64_t                       _seed = 0;
+};
+
+template<class... Keywords>
+constexpr keyword_switch<sizeof...( Keywords )> make_keyword_switch( const Keywords&... keywords )
+{
+	return keyword_switch<sizeof...( Keywords )>(
+		std::array<const_string_literal, sizeof...( Keywords )>{{const_string_literal( keywords )...}} );
+}
+
+#endif
@@ -0,0 +1,163 @@
+#ifndef CONST_STRING_MAPPED_FILE_H
+#define CONST_STRING_MAPPED_FILE_H
+
+#include "const_string.h"
+
+#include <cerrno>
+#include <cstddef>
+#include <string>
+#include <system_error>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace detail {
+
+// Read only mapping of a whole file. Unmapped on destruction
+class file_mapping {
+public:
+	explicit file_mapping( const char* path )
+	{
+#ifdef _WIN32
+		const HANDLE file = CreateFileA(
+			path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+		if( file == INVALID_HANDLE_VALUE ) {
+			_throw_last_error( "Can't open", path );
+		}
+		LARGE_INTEGER size{};
+		if( !GetFileSizeEx( file, &size ) ) {
+			CloseHandle( file );
+			_throw_last_error( "Can't determine size of", path );
+		}
+		_size = static_cast<std::size_t>( size.QuadPart );
+		if( _size != 0 ) {
+			const HANDLE mapping = CreateFileMappingA( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+			if( mapping != nullptr ) {
+				// the view keeps the mapping object alive
+				_data = static_cast<const char*>( MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 ) );
+				CloseHandle( mapping );
+			}
+		}
+		CloseHandle( file );
+		if( _size != 0 && _data == nullptr ) {
+			_throw_last_error( "Can't map", path );
+		}
+#else
+		const int fd = ::open( path, O_RDONLY | O_CLOEXEC );
+		if( fd == -1 ) {
+			_throw_errno( "Can't open", path );
+		}
+		struct stat info {};
+		if( ::fstat( fd, &info ) != 0 ) {
+			const int err = errno;
+			::close( fd );
+			_throw_errno( "Can't determine size of", path, err );
+		}
+		_size = static_cast<std::size_t>( info.st_size );
+		if( _size != 0 ) {
+			void* const addr = ::mmap( nullptr, _size, PROT_READ, MAP_SHARED, fd, 0 );
+			if( addr == MAP_FAILED ) {
+				const int err = errno;
+				::close( fd );
+				_throw_errno( "Can't map", path, err );
+			}
+			_data = static_cast<const char*>( addr );
+		}
+		// the mapping stays valid after closing the file
+		::close( fd );
+#endif
+	}
+
+	file_mapping( const file_mapping& ) = delete;
+	file_mapping& operator=( const file_mapping& ) = delete;
+
+	~file_mapping()
+	{
+		if( _data == nullptr ) {
+			return;
+		}
+#ifdef _WIN32
+		UnmapViewOfFile( _data );
+#else
+		::munmap( const_cast<char*>( _data ), _size );
+#endif
+	}
+
+	std::string_view view() const noexcept { return {_data, _size}; }
+
+	// The rest of the last page is filled with zeros, so there is a readable zero behind the data, unless the file
+	// size is a multiple of the page size
+	bool zero_terminated() const noexcept { return _data != nullptr && _size % _page_size() != 0; }
+
+private:
+	static std::size_t _page_size() noexcept
+	{
+#ifdef _WIN32
+		SYSTEM_INFO info;
+		GetSystemInfo( &info );
+		return info.dwPageSize;
+#else
+		return static_cast<std::size_t>( ::sysconf( _SC_PAGESIZE ) );
+#endif
+	}
+
+#ifdef _WIN32
+	[[noreturn]] static void _throw_last_error( const char* what, const char* path )
+	{
+		throw std::system_error( static_cast<int>( GetLastError() ),
+								 std::system_category(),
+								 std::string( "const_string: " ) + what + " file " + path );
+	}
+#else
+	[[noreturn]] static void _throw_errno( const char* what, const char* path, int err = errno )
+	{
+		throw std::system_error( err, std::generic_category(), std::string( "const_string: " ) + what + " file " + path );
+	}
+#endif
+
+	const char* _data = nullptr;
+	std::size_t _size = 0;
+};
+
+} // namespace detail
+
+/**
+ * Maps a file read only and returns a string referencing its content without copying it. The mapping is owned by the
+ * string's buffer, so substrings and split results share it and it gets unmapped when the last of them is destroyed.
+ * The file must not be modified while it is mapped.
+ *
+ * Throws std::system_error if the file can't be opened or mapped
+ */
+template<class CntPolicy = detail::atomic_ref_cnt_policy>
+basic_const_string<CntPolicy> map_file( const char* path )
+{
+	using Buffer_t = detail::basic_ref_cnt_buffer<CntPolicy>;
+
+	auto        handle  = Buffer_t::template make_owner<detail::file_mapping>( path );
+	const auto& mapping = *handle.template get_owner<detail::file_mapping>();
+	if( mapping.view().empty() ) {
+		return basic_const_string<CntPolicy>( "" );
+	}
+
+	const auto content = mapping.view();
+	handle.set_payload( content, mapping.zero_terminated() );
+	return detail::string_from_buffer::make<basic_const_string<CntPolicy>>(
+		std::move( handle ), content.data(), content.size() );
+}
+
+template<class CntPolicy = detail::atomic_ref_cnt_policy>
+basic_const_string<CntPolicy> map_file( const std::string& path )
+{
+	return map_file<CntPolicy>( path.c_str() );
+}
+
+#endif
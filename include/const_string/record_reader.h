@@ -0,0 +1,211 @@
+#ifndef CONST_STRING_RECORD_READER_H
+#define CONST_STRING_RECORD_READER_H
+
+#include "const_string.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <istream>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+/**
+ * Reads records (e.g. lines) from a stream or file descriptor. The input is read into large ref counted chunks and
+ * the records are returned as slices of those chunks, so there is one allocation per chunk instead of one per record.
+ * Only a record that crosses the end of a chunk is copied (into the next chunk).
+ *
+ * NOTE: A record keeps its whole chunk alive.
+ */
+template<class CntPolicy>
+class basic_record_reader {
+	using Buffer_t = detail::basic_ref_cnt_buffer<CntPolicy>;
+
+public:
+	using String_t = basic_const_string<CntPolicy>;
+
+	static constexpr std::size_t default_chunk_size = 1 << 20;
+
+	// NOTE: std::istream::read blocks until the chunk is full or the end of the stream is reached
+	explicit basic_record_reader( std::istream& in,
+								  char          delimiter  = '\n',
+								  std::size_t   chunk_size = default_chunk_size )
+		: _read( [&in]( char* buffer, std::size_t size ) -> std::size_t {
+			in.read( buffer, static_cast<std::streamsize>( size ) );
+			return static_cast<std::size_t>( in.gcount() );
+		} )
+		, _delimiter( delimiter )
+		, _chunk_size( std::max( chunk_size, std::size_t( 1 ) ) )
+	{
+	}
+
+	// Reads from a file descriptor (e.g. a pipe or socket). The descriptor isn't closed by the reader
+	explicit basic_record_reader( int fd, char delimiter = '\n', std::size_t chunk_size = default_chunk_size )
+		: _read( [fd]( char* buffer, std::size_t size ) { return _read_fd( fd, buffer, size ); } )
+		, _delimiter( delimiter )
+		, _chunk_size( std::max( chunk_size, std::size_t( 1 ) ) )
+	{
+	}
+
+	// a copy would fill the same chunk as the original and overwrite records that have already been handed out
+	basic_record_reader( const basic_record_reader& ) = delete;
+	basic_record_reader& operator=( const basic_record_reader& ) = delete;
+
+	// the moved from reader is left without input, so next() returns false
+	basic_record_reader( basic_record_reader&& other ) noexcept
+		: _read( std::exchange( other._read, read_fn_t{} ) )
+		, _delimiter( other._delimiter )
+		, _chunk_size( other._chunk_size )
+		, _handle( std::move( other._handle ) )
+		, _data( std::exchange( other._data, nullptr ) )
+		, _capacity( std::exchange( other._capacity, 0 ) )
+		, _pos( std::exchange( other._pos, 0 ) )
+		, _scan_pos( std::exchange( other._scan_pos, 0 ) )
+		, _end( std::exchange( other._end, 0 ) )
+		, _eof( std::exchange( other._eof, false ) )
+	{
+	}
+
+	basic_record_reader& operator=( basic_record_reader&& other ) noexcept
+	{
+		basic_record_reader tmp( std::move( other ) );
+		std::swap( _read, tmp._read );
+		std::swap( _delimiter, tmp._delimiter );
+		std::swap( _chunk_size, tmp._chunk_size );
+		swap( _handle, tmp._handle );
+		std::swap( _data, tmp._data );
+		std::swap( _capacity, tmp._capacity );
+		std::swap( _pos, tmp._pos );
+		std::swap( _scan_pos, tmp._scan_pos );
+		std::swap( _end, tmp._end );
+		std::swap( _eof, tmp._eof );
+		return *this;
+	}
+
+	/**
+	 * Stores the next record (without delimiter) in record. Returns false (and leaves record empty) when there are no
+	 * records left. Like split_full, a delimiter at the very end of the input doesn't start another (empty) record.
+	 */
+	bool next( String_t& record )
+	{
+		// drop the previous record first, so the current chunk can be reused if nobody else holds on to it
+		record = String_t{};
+		while( true ) {
+			const std::string_view unscanned( _data + _scan_pos, _end - _scan_pos );
+			const auto             found = unscanned.find( _delimiter );
+			if( found != std::string_view::npos ) {
+				record    = _record( _scan_pos + found );
+				_pos      = _scan_pos + found + 1;
+				_scan_pos = _pos;
+				return true;
+			}
+			_scan_pos = _end;
+
+			if( _eof ) {
+				if( _pos == _end ) {
+					return false;
+				}
+				record = _record( _end );
+				_pos   = _end;
+				return true;
+			}
+			_fill();
+		}
+	}
+
+private:
+	using read_fn_t = std::function<std::size_t( char*, std::size_t )>;
+
+	String_t _record( std::size_t end_pos ) const
+	{
+		return detail::string_from_buffer::make<String_t>( Buffer_t( _handle ), _data + _pos, end_pos - _pos );
+	}
+
+	void _fill()
+	{
+		if( !_read ) {
+			// moved from
+			_eof = true;
+			return;
+		}
+		if( _end == _capacity ) {
+			_make_room();
+		}
+		const std::size_t cnt = _read( _data + _end, _capacity - _end );
+		if( cnt == 0 ) {
+			_eof = true;
+			return;
+		}
+		_end += cnt;
+		// records ending at _end are only returned once no more data is written to this chunk
+		_data[_end] = '\0';
+	}
+
+	// moves the incomplete record at the end of the current chunk to the start of an empty chunk
+	void _make_room()
+	{
+		const std::size_t pending = _end - _pos;
+		if( _handle && _handle.get_ref_cnt() == 1 && pending < _capacity ) {
+			// no records of this chunk are in use anymore, so we can reuse it
+			std::memmove( _data, _data + _pos, pending );
+		} else {
+			// a record, that doesn't fit into a single chunk, gets a bigger one
+			const std::size_t new_capacity = std::max( _chunk_size, 2 * pending );
+			auto res = detail::allocate_null_terminated_char_buffer<CntPolicy>( new_capacity );
+			std::copy_n( _data + _pos, pending, res.data );
+			_handle   = std::move( res.handle );
+			_data     = res.data;
+			_capacity = new_capacity;
+		}
+		_scan_pos = _scan_pos - _pos;
+		_pos      = 0;
+		_end      = pending;
+	}
+
+	static std::size_t _read_fd( int fd, char* buffer, std::size_t size )
+	{
+		while( true ) {
+#ifdef _WIN32
+			const auto cnt = ::_read( fd, buffer, static_cast<unsigned>( std::min<std::size_t>( size, INT_MAX ) ) );
+#else
+			const auto cnt = ::read( fd, buffer, size );
+#endif
+			if( cnt >= 0 ) {
+				return static_cast<std::size_t>( cnt );
+			}
+			if( errno != EINTR ) {
+				throw std::system_error( errno, std::generic_category(), "const_string: Can't read from file descriptor" );
+			}
+		}
+	}
+
+	read_fn_t   _read;
+	char        _delimiter;
+	std::size_t _chunk_size;
+
+	Buffer_t    _handle{};
+	char*       _data     = nullptr;
+	std::size_t _capacity = 0;
+	// start of the next record
+	std::size_t _pos = 0;
+	// [_pos, _scan_pos) is known to not contain a delimiter
+	std::size_t _scan_pos = 0;
+	// end of the data read so far
+	std::size_t _end = 0;
+	bool        _eof = false;
+};
+
+using record_reader       = basic_record_reader<detail::atomic_ref_cnt_policy>;
+using local_record_reader = basic_record_reader<detail::local_ref_cnt_policy>;
+
+#endif
@@ -0,0 +1,304 @@
+#ifndef CONST_STRING_STRING_TABLE_H
+#define CONST_STRING_STRING_TABLE_H
+
+#include "const_string.h"
+#include "mapped_file.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Binary format to persist a collection of strings, which can be loaded without an allocation per string: The whole
+ * file is mapped (or read) into a single buffer and the strings are handed out as slices of it.
+ *
+ * Layout (all integers little endian):
+ *   header:  "CSTB", u32 version, u32 flags, u32 reserved, u64 count, u64 unique_count, u64 data_size
+ *   offsets: (unique_count + 1) x u64 - unique string i is data[offsets[i], offsets[i+1] - 1) (followed by '\0')
+ *   ids:     count x u32 - index of the unique string for each string (only if flags & has_ids, i.e. deduplicated)
+ *   data:    data_size bytes of zero terminated strings
+ */
+template<class CntPolicy>
+class basic_string_table {
+public:
+	using String_t = basic_const_string<CntPolicy>;
+
+	enum class Dedup { No, Yes };
+
+	basic_string_table() = default;
+
+	// Parses a string table from the content of a file. Throws std::runtime_error if the data is not a valid table
+	explicit basic_string_table( String_t file )
+		: _file( std::move( file ) )
+	{
+		_parse();
+	}
+
+	// Maps the file. Throws std::system_error if the file can't be mapped and std::runtime_error if it is invalid
+	static basic_string_table load( const std::string& path )
+	{
+		return basic_string_table( map_file<CntPolicy>( path ) );
+	}
+
+	// Reads the whole stream into a single buffer
+	static basic_string_table read( std::istream& in )
+	{
+		std::string content( std::istreambuf_iterator<char>( in ), std::istreambuf_iterator<char>{} );
+		// the buffer of the string is adopted, not copied
+		return basic_string_table( String_t( std::move( content ) ) );
+	}
+
+	/**
+	 * Writes all strings of a range in the string table format. With Dedup::Yes, equal strings are only stored once.
+	 * The range is iterated twice and its elements have to stay alive in between (e.g. a container of strings).
+	 * Throws std::length_error if there are more than 2^32 - 1 strings.
+	 */
+	template<class Range>
+	static void write( std::ostream& out, const Range& strings, Dedup dedup = Dedup::No );
+
+	std::size_t size() const noexcept { return _cnt; }
+	bool        empty() const noexcept { return _cnt == 0; }
+
+	// the i-th string (without creating a const_string)
+	std::string_view view( std::size_t i ) const noexcept
+	{
+		const char* const file  = _file.data();
+		const std::size_t u     = _ids_pos ? _read_u32( file + _ids_pos + 4 * i ) : i;
+		const std::size_t begin = _read_u64( file + header_size + 8 * u );
+		const std::size_t end   = _read_u64( file + header_size + 8 * ( u + 1 ) ) - 1;
+		return std::string_view( file + _chars_pos + begin, end - begin );
+	}
+
+	// the i-th string as slice of the table's buffer
+	String_t operator[]( std::size_t i ) const
+	{
+		const std::string_view str = view( i );
+		return _file.substr( _pos( str ), str.size() );
+	}
+
+	class view_iterator {
+	public:
+		using iterator_concept  = std::forward_iterator_tag;
+		using iterator_category = std::input_iterator_tag; // operator* doesn't return a reference
+		using value_type        = std::string_view;
+		using difference_type   = std::ptrdiff_t;
+		using pointer           = const std::string_view*;
+		using reference         = std::string_view;
+
+		view_iterator() = default;
+
+		std::string_view operator*() const noexcept { return _table->view( _idx ); }
+		view_iterator&   operator++() noexcept
+		{
+			++_idx;
+			return *this;
+		}
+		view_iterator operator++( int ) noexcept
+		{
+			auto ret = *this;
+			++_idx;
+			return ret;
+		}
+		friend bool operator==( view_iterator l, view_iterator r ) noexcept { return l._idx == r._idx; }
+		friend bool operator!=( view_iterator l, view_iterator r ) noexcept { return l._idx != r._idx; }
+
+	private:
+		friend class basic_string_table;
+		view_iterator( const basic_string_table* table, std::size_t idx ) noexcept
+			: _table( table )
+			, _idx( idx )
+		{
+		}
+
+		const basic_string_table* _table = nullptr;
+		std::size_t               _idx   = 0;
+	};
+
+	view_iterator begin() const noexcept { return view_iterator( this, 0 ); }
+	view_iterator end() const noexcept { return view_iterator( this, _cnt ); }
+
+	// All strings as slices of the table's buffer (the reference count is incremented only once for all of them)
+	std::vector<String_t> to_vector() const
+	{
+		std::vector<String_t> ret;
+		ret.reserve( _cnt );
+		_file.slices_into( *this, ret );
+		return ret;
+	}
+
+	// the buffer holding the whole table
+	const String_t& buffer() const noexcept { return _file; }
+
+private:
+	static constexpr std::string_view magic       = "CSTB";
+	static constexpr std::uint32_t    version     = 1;
+	static constexpr std::uint32_t    has_ids     = 1;
+	static constexpr std::size_t      header_size = 40;
+
+	std::size_t _pos( std::string_view str ) const noexcept
+	{
+		return static_cast<std::size_t>( str.data() - _file.data() );
+	}
+
+	static std::uint64_t _read_u64( const char* p ) noexcept
+	{
+		std::uint64_t ret = 0;
+		for( int i = 7; i >= 0; --i ) {
+			ret = ( ret << 8 ) | static_cast<unsigned char>( p[i] );
+		}
+		return ret;
+	}
+
+	static std::uint32_t _read_u32( const char* p ) noexcept
+	{
+		std::uint32_t ret = 0;
+		for( int i = 3; i >= 0; --i ) {
+			ret = ( ret << 8 ) | static_cast<unsigned char>( p[i] );
+		}
+		return ret;
+	}
+
+	static void _append_u64( std::string& out, std::uint64_t value )
+	{
+		for( int i = 0; i < 8; ++i ) {
+			out.push_back( static_cast<char>( ( value >> ( 8 * i ) ) & 0xff ) );
+		}
+	}
+
+	static void _append_u32( std::string& out, std::uint32_t value )
+	{
+		for( int i = 0; i < 4; ++i ) {
+			out.push_back( static_cast<char>( ( value >> ( 8 * i ) ) & 0xff ) );
+		}
+	}
+
+	[[noreturn]] static void _invalid( const char* what )
+	{
+		throw std::runtime_error( std::string( "const_string: Invalid string table (" ) + what + ")" );
+	}
+
+	// validates the whole table, so the accessors don't have to check anything
+	void _parse()
+	{
+		const std::string_view file = _file;
+		if( file.size() < header_size || file.substr( 0, 4 ) != magic ) {
+			_invalid( "no string table header" );
+		}
+		if( _read_u32( file.data() + 4 ) != version ) {
+			_invalid( "unsupported version" );
+		}
+		const std::uint32_t flags     = _read_u32( file.data() + 8 );
+		const std::uint64_t cnt       = _read_u64( file.data() + 16 );
+		const std::uint64_t unique    = _read_u64( file.data() + 24 );
+		const std::uint64_t data_size = _read_u64( file.data() + 32 );
+
+		const bool          ids       = ( flags & has_ids ) != 0;
+		const std::uint64_t remaining = file.size() - header_size;
+		if( unique > cnt || ( !ids && unique != cnt ) || unique >= remaining / 8
+			|| ( ids && cnt > ( remaining - 8 * ( unique + 1 ) ) / 4 )
+			|| remaining - 8 * ( unique + 1 ) - ( ids ? 4 * cnt : 0 ) != data_size ) {
+			_invalid( "inconsistent sizes" );
+		}
+
+		_cnt       = static_cast<std::size_t>( cnt );
+		_ids_pos   = ids ? header_size + 8 * static_cast<std::size_t>( unique + 1 ) : 0;
+		_chars_pos = file.size() - static_cast<std::size_t>( data_size );
+
+		const char* const offsets = file.data() + header_size;
+		const char* const chars   = file.data() + _chars_pos;
+		std::uint64_t     prev    = 0;
+		for( std::size_t u = 0; u <= unique; ++u ) {
+			const auto offset = _read_u64( offsets + 8 * u );
+			if( offset > data_size || ( u == 0 && offset != 0 )
+				|| ( u != 0 && ( offset <= prev || chars[offset - 1] != '\0' ) ) ) {
+				_invalid( "bad offset" );
+			}
+			prev = offset;
+		}
+		if( prev != data_size ) {
+			_invalid( "bad offset" );
+		}
+		for( std::size_t i = 0; ids && i < _cnt; ++i ) {
+			if( _read_u32( file.data() + _ids_pos + 4 * i ) >= unique ) {
+				_invalid( "bad id" );
+			}
+		}
+	}
+
+	// the sections are stored as positions in _file (the offsets start at header_size), not as pointers, as a short
+	// file might be stored inline and move with the table
+	String_t    _file;
+	std::size_t _ids_pos   = 0; // 0 if there are no ids
+	std::size_t _chars_pos = 0;
+	std::size_t _cnt       = 0;
+};
+
+template<class CntPolicy>
+template<class Range>
+void basic_string_table<CntPolicy>::write( std::ostream& out, const Range& strings, Dedup dedup )
+{
+	std::string                                         offsets;
+	std::string                                         ids;
+	std::unordered_map<std::string_view, std::uint32_t> unique_ids;
+
+	std::uint64_t cnt       = 0;
+	std::uint64_t unique    = 0;
+	std::uint64_t data_size = 0;
+	_append_u64( offsets, 0 );
+	for( auto&& e : strings ) {
+		const std::string_view str( e );
+		if( cnt == std::numeric_limits<std::uint32_t>::max() ) {
+			throw std::length_error( "const_string: Too many strings for a string table" );
+		}
+		cnt++;
+		if( dedup == Dedup::Yes ) {
+			const auto [it, inserted] = unique_ids.emplace( str, static_cast<std::uint32_t>( unique ) );
+			_append_u32( ids, it->second );
+			if( !inserted ) {
+				continue;
+			}
+		}
+		unique++;
+		data_size += str.size() + 1;
+		_append_u64( offsets, data_size );
+	}
+
+	std::string header( magic );
+	_append_u32( header, version );
+	_append_u32( header, dedup == Dedup::Yes ? has_ids : 0 );
+	_append_u32( header, 0 );
+	_append_u64( header, cnt );
+	_append_u64( header, unique );
+	_append_u64( header, data_size );
+
+	out.write( header.data(), static_cast<std::streamsize>( header.size() ) );
+	out.write( offsets.data(), static_cast<std::streamsize>( offsets.size() ) );
+	out.write( ids.data(), static_cast<std::streamsize>( ids.size() ) );
+
+	// with dedup, the strings have to be written in the order in which they got their id
+	for( auto&& e : strings ) {
+		const std::string_view str( e );
+		if( dedup == Dedup::Yes ) {
+			const auto it = unique_ids.find( str );
+			if( it == unique_ids.end() ) {
+				continue; // already written
+			}
+			unique_ids.erase( it );
+		}
+		out.write( str.data(), static_cast<std::streamsize>( str.size() ) );
+		out.put( '\0' );
+	}
+}
+
+using string_table       = basic_string_table<detail::atomic_ref_cnt_policy>;
+using local_string_table = basic_string_table<detail::local_ref_cnt_policy>;
+
+#endif
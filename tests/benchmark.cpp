@@ -0,0 +1,687 @@
+#include <const_string/const_string.h>
+#include <const_string/const_string_vector.h>
+#include <const_string/hot_const_string.h>
+#include <const_string/keyword_switch.h>
+#include <const_string/string_table.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "helpers.hpp"
+
+/**
+ * Micro benchmarks for the basic operations of const_string, compared to std::string and
+ * std::shared_ptr<const std::string> for several string lengths.
+ *
+ * Usage: const_string_benchmark [--format=table|csv|json] [--filter=<substring of benchmark name>] [--quick]
+ *
+ * Each benchmark runs an operation over a batch of strings until min_time has passed (several samples) and reports
+ * the median time per operation. The contention benchmarks run on several threads and report the wall clock time
+ * divided by the total number of operations of all threads (so ideal scaling halves the value with each doubling).
+ * The memory rows report the average size of a string object plus the heap memory it owns.
+ */
+
+namespace {
+
+/* ############### Harness ######################################## */
+
+struct Options {
+	enum class Format { Table, Csv, Json } format = Format::Table;
+	std::string                            filter;
+	std::chrono::milliseconds              min_time{100};
+	int                                    samples = 5;
+};
+
+struct Result {
+	std::string name;
+	std::string type;
+	std::size_t length;
+	std::size_t threads;
+	double      value;
+	std::string unit;
+};
+
+// prevents the compiler from optimizing away the benchmarked operations
+volatile std::size_t sink = 0;
+
+template<class T>
+void consume( const T& v )
+{
+	sink = sink + std::size( v );
+}
+
+class Runner {
+public:
+	explicit Runner( Options options )
+		: _options( std::move( options ) )
+	{
+	}
+
+	// op() has to perform ops_per_call operations (in total, if it uses several threads)
+	template<class Op>
+	void run( const std::string& name,
+			  const std::string& type,
+			  std::size_t        length,
+			  std::size_t        ops_per_call,
+			  Op&&               op,
+			  std::size_t        threads = 1 )
+	{
+		const std::string full_name
+			= name + "/" + type + "/" + std::to_string( length ) + ( threads > 1 ? "/" + std::to_string( threads ) : "" );
+		if( full_name.find( _options.filter ) == std::string::npos ) {
+			return;
+		}
+
+		using clock = std::chrono::steady_clock;
+		op(); // warm up
+		std::vector<double> samples;
+		for( int s = 0; s < _options.samples; ++s ) {
+			const auto  min_time = _options.min_time / _options.samples;
+			std::size_t calls    = 0;
+			const auto  start    = clock::now();
+			auto        end      = start;
+			do {
+				op();
+				calls++;
+				end = clock::now();
+			} while( end - start < min_time );
+			samples.push_back( std::chrono::duration<double, std::nano>( end - start ).count()
+							   / static_cast<double>( calls * ops_per_call ) );
+		}
+		std::sort( samples.begin(), samples.end() );
+		_add_result( {name, type, length, threads, samples[samples.size() / 2], "ns/op"} );
+	}
+
+	// reports a value that isn't a time (e.g. memory usage)
+	void record( const std::string& name,
+				 const std::string& type,
+				 std::size_t        length,
+				 double             value,
+				 const std::string& unit )
+	{
+		if( ( name + "/" + type + "/" + std::to_string( length ) ).find( _options.filter ) == std::string::npos ) {
+			return;
+		}
+		_add_result( {name, type, length, 1, value, unit} );
+	}
+
+	void finish() const
+	{
+		if( _options.format == Options::Format::Csv ) {
+			std::cout << "benchmark,type,length,threads,value,unit\n";
+			for( const auto& r : _results ) {
+				std::cout << r.name << ',' << r.type << ',' << r.length << ',' << r.threads << ',' << r.value << ','
+						  << r.unit << '\n';
+			}
+		} else if( _options.format == Options::Format::Json ) {
+			std::cout << "[\n";
+			for( std::size_t i = 0; i < _results.size(); ++i ) {
+				const auto& r = _results[i];
+				std::cout << "  {\"benchmark\": \"" << r.name << "\", \"type\": \"" << r.type
+						  << "\", \"length\": " << r.length << ", \"threads\": " << r.threads
+						  << ", \"value\": " << r.value << ", \"unit\": \"" << r.unit << "\"}"
+						  << ( i + 1 < _results.size() ? ",\n" : "\n" );
+			}
+			std::cout << "]\n";
+		}
+	}
+
+private:
+	void _add_result( Result result )
+	{
+		_results.push_back( std::move( result ) );
+		if( _options.format == Options::Format::Table ) {
+			_print_table_row( _results.back() );
+		}
+	}
+
+	static void _print_table_row( const Result& r )
+	{
+		std::cout.width( 20 );
+		std::cout << std::left << r.name;
+		std::cout.width( 30 );
+		std::cout << r.type;
+		std::cout.width( 8 );
+		std::cout << std::right << r.length;
+		std::cout.width( 5 );
+		std::cout << r.threads;
+		std::cout.width( 12 );
+		std::cout << r.value << " " << r.unit << std::endl;
+	}
+
+	Options             _options;
+	std::vector<Result> _results;
+};
+
+/* ############### String types ######################################## */
+// Common interface for the compared types
+
+template<class T>
+struct Traits;
+
+template<>
+struct Traits<std::string> {
+	static constexpr const char* name = "std::string";
+
+	static std::string make( std::string_view sv ) { return std::string( sv ); }
+	static std::string substr( const std::string& s, std::size_t pos, std::size_t len )
+	{
+		return s.substr( pos, len );
+	}
+	static std::string_view view( const std::string& s ) { return s; }
+	// size of the object plus the heap memory it owns (without the overhead of the allocator)
+	static std::size_t memory( const std::string& s )
+	{
+		const auto obj            = reinterpret_cast<const char*>( &s );
+		const bool inline_storage = obj <= s.data() && s.data() < obj + sizeof( s );
+		return sizeof( s ) + ( inline_storage ? 0 : s.capacity() + 1 );
+	}
+};
+
+using shared_string = std::shared_ptr<const std::string>;
+
+template<>
+struct Traits<shared_string> {
+	static constexpr const char* name = "shared_ptr<const string>";
+
+	static shared_string make( std::string_view sv ) { return std::make_shared<const std::string>( sv ); }
+	static shared_string substr( const shared_string& s, std::size_t pos, std::size_t len )
+	{
+		return std::make_shared<const std::string>( s->substr( pos, len ) );
+	}
+	static std::string_view view( const shared_string& s ) { return *s; }
+	// make_shared puts the control block (vtable pointer and two counters) and the string into one allocation
+	static std::size_t memory( const shared_string& s )
+	{
+		return sizeof( s ) + 2 * sizeof( void* ) + Traits<std::string>::memory( *s );
+	}
+};
+
+template<class CntPolicy>
+struct Traits<basic_const_string<CntPolicy>> {
+	static constexpr const char* name = CntPolicy::thread_safe ? "const_string" : "local_const_string";
+
+	using String_t = basic_const_string<CntPolicy>;
+
+	static String_t make( std::string_view sv ) { return String_t( sv ); }
+	static String_t substr( const String_t& s, std::size_t pos, std::size_t len ) { return s.substr( pos, len ); }
+	static std::string_view view( const String_t& s ) { return s; }
+	// the heap buffer consists of the header (see detail::basic_ref_cnt_header) and the zero terminated characters
+	static std::size_t memory( const String_t& s )
+	{
+		const std::size_t chars = s.retained_bytes();
+		return sizeof( s ) + ( chars == 0 ? 0 : detail::basic_ref_cnt_buffer<CntPolicy>::header_size + chars + 1 );
+	}
+};
+
+// strings of the given length with a delimiter (' ') every 8 characters on average
+std::vector<std::string> make_inputs( std::size_t length, std::size_t cnt )
+{
+	std::vector<std::string> inputs( cnt );
+	for( std::size_t i = 0; i < inputs.size(); ++i ) {
+		inputs[i].resize( length );
+		for( std::size_t c = 0; c < length; ++c ) {
+			inputs[i][c] = ( ( c + i ) % 8 == 7 ) ? ' ' : random_string_alphabet[( c * 7 + i ) % 26];
+		}
+	}
+	return inputs;
+}
+
+/* ############### Benchmarks ######################################## */
+
+template<class String>
+void bench_basic_ops( Runner& runner, const std::vector<std::string>& inputs, std::size_t length )
+{
+	using T = Traits<String>;
+
+	const std::size_t cnt   = inputs.size();
+	const char*       tname = T::name;
+
+	std::vector<String> strings;
+	for( const auto& in : inputs ) {
+		strings.push_back( T::make( in ) );
+	}
+
+	std::size_t memory = 0;
+	for( const auto& s : strings ) {
+		memory += T::memory( s );
+	}
+	runner.record(
+		"memory", tname, length, static_cast<double>( memory ) / static_cast<double>( cnt ), "bytes/string" );
+
+	runner.run( "construct", tname, length, cnt, [&] {
+		for( const auto& in : inputs ) {
+			consume( T::view( T::make( in ) ) );
+		}
+	} );
+
+	runner.run( "copy", tname, length, cnt, [&] {
+		for( const auto& s : strings ) {
+			String copy = s;
+			consume( T::view( copy ) );
+		}
+	} );
+
+	std::vector<String> moved = strings;
+	runner.run( "move", tname, length, cnt, [&] {
+		for( auto& s : moved ) {
+			String tmp = std::move( s );
+			s          = std::move( tmp );
+		}
+	} );
+
+	runner.run( "substr", tname, length, cnt, [&] {
+		for( const auto& s : strings ) {
+			consume( T::view( T::substr( s, length / 4, length / 2 ) ) );
+		}
+	} );
+
+	std::vector<String> equal_copies;
+	for( const auto& in : inputs ) {
+		equal_copies.push_back( T::make( in ) );
+	}
+	runner.run( "compare", tname, length, cnt, [&] {
+		std::size_t equal = 0;
+		for( std::size_t i = 0; i < cnt; ++i ) {
+			equal += T::view( strings[i] ) == T::view( equal_copies[i] );
+			equal += T::view( strings[i] ) < T::view( equal_copies[( i + 1 ) % cnt] );
+		}
+		sink = sink + equal;
+	} );
+}
+
+template<class String>
+void bench_split( Runner& runner, const std::vector<std::string>& inputs, std::size_t length )
+{
+	std::vector<String> strings( inputs.begin(), inputs.end() );
+	const char*         tname = Traits<String>::name;
+
+	runner.run( "split_full", tname, length, inputs.size(), [&] {
+		for( const auto& s : strings ) {
+			consume( s.split_full( ' ' ) );
+		}
+	} );
+
+	runner.run( "split_full_flat", tname, length, inputs.size(), [&] {
+		for( const auto& s : strings ) {
+			consume( split_full_flat( s, ' ' ) );
+		}
+	} );
+
+	std::vector<String> reused;
+	runner.run( "split_into", tname, length, inputs.size(), [&] {
+		for( const auto& s : strings ) {
+			reused.clear();
+			s.split_into( ' ', reused );
+			consume( reused );
+		}
+	} );
+
+	runner.run( "split_lazy", tname, length, inputs.size(), [&] {
+		for( const auto& s : strings ) {
+			std::size_t cnt = 0;
+			for( const auto& token : s.split_lazy( ' ' ) ) {
+				cnt += token.size();
+			}
+			sink = sink + cnt;
+		}
+	} );
+}
+
+void bench_split_std( Runner& runner, const std::vector<std::string>& inputs, std::size_t length )
+{
+	runner.run( "split_full", "std::string", length, inputs.size(), [&] {
+		for( const auto& s : inputs ) {
+			std::vector<std::string> tokens;
+			std::size_t              start = 0;
+			while( start < s.size() ) {
+				const auto end = std::min( s.find( ' ', start ), s.size() );
+				tokens.push_back( s.substr( start, end - start ) );
+				start = end + 1;
+			}
+			consume( tokens );
+		}
+	} );
+}
+
+void bench_concat( Runner& runner, const std::vector<std::string>& inputs, std::size_t length )
+{
+	const auto        strings = to_const_strings( inputs );
+	const std::size_t cnt     = inputs.size();
+
+	runner.run( "concat_variadic", "const_string", length, cnt, [&] {
+		for( std::size_t i = 0; i < cnt; ++i ) {
+			consume( concat( strings[i], ", ", strings[( i + 1 ) % cnt] ) );
+		}
+	} );
+	runner.run( "concat_variadic", "std::string", length, cnt, [&] {
+		for( std::size_t i = 0; i < cnt; ++i ) {
+			consume( inputs[i] + ", " + inputs[( i + 1 ) % cnt] );
+		}
+	} );
+
+	// key building with a number
+	runner.run( "concat_number", "const_string", length, cnt, [&] {
+		for( std::size_t i = 0; i < cnt; ++i ) {
+			consume( concat( strings[i], '=', i * 977 ) );
+		}
+	} );
+	runner.run( "concat_number", "std::string", length, cnt, [&] {
+		for( std::size_t i = 0; i < cnt; ++i ) {
+			consume( inputs[i] + '=' + std::to_string( i * 977 ) );
+		}
+	} );
+
+	// range: all strings at once
+	runner.run( "concat_range", "const_string", length, cnt, [&] { consume( concat( strings ) ); } );
+	runner.run( "concat_range", "std::string", length, cnt, [&] {
+		std::string ret;
+		for( const auto& s : inputs ) {
+			ret += s;
+		}
+		consume( ret );
+	} );
+}
+
+void bench_zstr( Runner& runner, const std::vector<std::string>& inputs, std::size_t length )
+{
+	const auto strings = to_const_strings( inputs );
+	std::vector<const_string> substrings;
+	for( const auto& s : strings ) {
+		substrings.push_back( s.substr( 0, length / 2 ) );
+	}
+
+	runner.run( "createZStr_shared", "const_string", length, strings.size(), [&] {
+		for( const auto& s : strings ) {
+			consume( std::string_view( s.createZStr().c_str() ) );
+		}
+	} );
+	runner.run( "createZStr_copy", "const_string", length, substrings.size(), [&] {
+		for( const auto& s : substrings ) {
+			consume( std::string_view( s.createZStr().c_str() ) );
+		}
+	} );
+}
+
+// Maps tokens to the index of a keyword (e.g. in a protocol parser)
+void bench_keywords( Runner& runner )
+{
+	constexpr auto keywords = make_keyword_switch(
+		"accept", "accept-encoding", "accept-language", "authorization", "cache-control", "connection",
+		"content-encoding", "content-length", "content-type", "cookie", "date", "etag", "expect", "expires", "host",
+		"if-match", "if-modified-since", "if-none-match", "last-modified", "location", "origin", "pragma", "range",
+		"referer", "server", "set-cookie", "transfer-encoding", "upgrade", "user-agent", "vary", "via", "warning" );
+	const std::size_t cnt = keywords.size();
+
+	// every 4th token is no keyword
+	std::vector<const_string> tokens;
+	for( std::size_t i = 0; i < 1024; ++i ) {
+		const auto keyword = keywords[( i * 7 ) % cnt].view();
+		tokens.push_back( const_string( i % 4 == 3 ? std::string( keyword ) + "-x" : std::string( keyword ) ) );
+	}
+
+	runner.run( "keyword_lookup", "if chain", cnt, tokens.size(), [&] {
+		std::size_t sum = 0;
+		for( const auto& token : tokens ) {
+			for( std::size_t k = 0; k < cnt; ++k ) {
+				if( token == keywords[k] ) {
+					sum += k;
+					break;
+				}
+			}
+		}
+		sink = sink + sum;
+	} );
+
+	std::unordered_map<const_string, int, const_string_hash, const_string_equal> map;
+	for( std::size_t k = 0; k < cnt; ++k ) {
+		map.emplace( keywords[k], static_cast<int>( k ) );
+	}
+	runner.run( "keyword_lookup", "unordered_map", cnt, tokens.size(), [&] {
+		std::size_t sum = 0;
+		for( const auto& token : tokens ) {
+			const auto it = map.find( token );
+			sum += it != map.end() ? static_cast<std::size_t>( it->second ) : 0;
+		}
+		sink = sink + sum;
+	} );
+
+	runner.run( "keyword_lookup", "keyword_switch", cnt, tokens.size(), [&] {
+		std::size_t sum = 0;
+		for( const auto& token : tokens ) {
+			const int idx = keywords.find( token );
+			sum += idx != keywords.not_found ? static_cast<std::size_t>( idx ) : 0;
+		}
+		sink = sink + sum;
+	} );
+}
+
+// runs op( thread_idx ) on each of the given number of threads and waits for them to finish
+template<class Op>
+void on_threads( std::size_t threads, Op&& op )
+{
+	std::vector<std::thread> workers;
+	for( std::size_t t = 0; t < threads; ++t ) {
+		workers.emplace_back( [&op, t] { op( t ); } );
+	}
+	for( auto& w : workers ) {
+		w.join();
+	}
+}
+
+// Copies (and destroys) the same string on all threads
+void bench_contention( Runner& runner, std::size_t threads )
+{
+	constexpr std::size_t length      = 64;
+	constexpr std::size_t ops_per_thr = 20'000;
+	const std::string     input       = make_inputs( length, 1 )[0];
+	const std::size_t     total_ops   = threads * ops_per_thr;
+
+	const shared_string shared_str = Traits<shared_string>::make( input );
+	runner.run( "copy_contended", Traits<shared_string>::name, length, total_ops,
+				[&] {
+					on_threads( threads, [&]( std::size_t ) {
+						for( std::size_t i = 0; i < ops_per_thr; ++i ) {
+							shared_string copy = shared_str;
+							consume( *copy );
+						}
+					} );
+				},
+				threads );
+
+	const const_string str( input );
+	runner.run( "copy_contended", "const_string", length, total_ops,
+				[&] {
+					on_threads( threads, [&]( std::size_t ) {
+						for( std::size_t i = 0; i < ops_per_thr; ++i ) {
+							const_string copy = str;
+							consume( copy );
+						}
+					} );
+				},
+				threads );
+
+	// no reference counting at all
+	const const_string literal( "literals don't need any reference counting, so they are cheap to copy...." );
+	runner.run( "copy_contended", "const_string literal", length, total_ops,
+				[&] {
+					on_threads( threads, [&]( std::size_t ) {
+						for( std::size_t i = 0; i < ops_per_thr; ++i ) {
+							const_string copy = literal;
+							consume( copy );
+						}
+					} );
+				},
+				threads );
+
+	const const_string immortal = const_string( input ).make_immortal();
+	runner.run( "copy_contended", "const_string immortal", length, total_ops,
+				[&] {
+					on_threads( threads, [&]( std::size_t ) {
+						for( std::size_t i = 0; i < ops_per_thr; ++i ) {
+							const_string copy = immortal;
+							consume( copy );
+						}
+					} );
+				},
+				threads );
+
+	// each copy goes through the thread local proxy cache
+	const hot_const_string hot( str );
+	runner.run( "copy_contended", "hot_const_string::local", length, total_ops,
+				[&] {
+					on_threads( threads, [&]( std::size_t ) {
+						for( std::size_t i = 0; i < ops_per_thr; ++i ) {
+							local_const_string copy = hot.local();
+							consume( copy );
+						}
+					} );
+				},
+				threads );
+
+	// one conversion per thread, copies of the local_const_string afterwards
+	runner.run( "copy_contended", "local_const_string proxy", length, total_ops,
+				[&] {
+					on_threads( threads, [&]( std::size_t ) {
+						const local_const_string local( str );
+						for( std::size_t i = 0; i < ops_per_thr; ++i ) {
+							local_const_string copy = local;
+							consume( copy );
+						}
+					} );
+				},
+				threads );
+}
+
+// Splits one big string on an increasing number of threads
+void bench_parallel_split( Runner& runner, std::size_t max_threads )
+{
+	constexpr std::size_t length = 32 * 1024 * 1024;
+	const const_string    str( make_inputs( length, 1 )[0] );
+
+	runner.run( "split_full", "const_string", length, 1, [&] { consume( str.split_full( ' ' ) ); } );
+	for( std::size_t threads = 1; threads <= max_threads; threads *= 2 ) {
+		runner.run(
+			"split_full_parallel", "const_string", length, 1,
+			[&] { consume( str.split_full_parallel( ' ', threads ) ); }, threads );
+	}
+}
+
+// Joins a big batch of records (the result is big enough to be copied on several threads)
+void bench_join( Runner& runner )
+{
+	const auto        inputs  = make_inputs( 128, 256 * 1024 );
+	const auto        records = to_const_strings( inputs );
+	const std::size_t length  = inputs.size() * ( inputs[0].size() + 1 );
+
+	runner.run( "join", "const_string", length, 1, [&] { consume( join( records, "\n" ) ); } );
+	runner.run( "join", "std::string", length, 1, [&] {
+		std::string ret;
+		ret.reserve( length );
+		for( const auto& r : inputs ) {
+			if( !ret.empty() ) {
+				ret += '\n';
+			}
+			ret += r;
+		}
+		consume( ret );
+	} );
+}
+
+void bench_string_table( Runner& runner )
+{
+	const auto        inputs = make_inputs( 64, 64 * 1024 );
+	const std::size_t length = inputs.size() * inputs[0].size();
+
+	std::ostringstream out;
+	string_table::write( out, inputs );
+	const std::string serialized = out.str();
+
+	runner.run( "load_strings", "string_table", length, 1, [&] {
+		std::istringstream in( serialized );
+		consume( string_table::read( in ).to_vector() );
+	} );
+	runner.run( "load_strings", "const_string", length, 1, [&] {
+		// the same data, but one allocation per string
+		std::istringstream        in( serialized );
+		const auto                table = string_table::read( in );
+		std::vector<const_string> ret;
+		ret.reserve( table.size() );
+		for( std::string_view str : table ) {
+			ret.emplace_back( str );
+		}
+		consume( ret );
+	} );
+}
+
+Options parse_options( int argc, char** argv )
+{
+	Options options;
+	for( int i = 1; i < argc; ++i ) {
+		const std::string_view arg = argv[i];
+		if( arg == "--format=csv" ) {
+			options.format = Options::Format::Csv;
+		} else if( arg == "--format=json" ) {
+			options.format = Options::Format::Json;
+		} else if( arg == "--format=table" ) {
+			options.format = Options::Format::Table;
+		} else if( arg.substr( 0, 9 ) == "--filter=" ) {
+			options.filter = std::string( arg.substr( 9 ) );
+		} else if( arg == "--quick" ) {
+			options.min_time = std::chrono::milliseconds{10};
+			options.samples  = 3;
+		} else {
+			std::cerr << "Unknown argument " << arg
+					  << "\nUsage: " << argv[0] << " [--format=table|csv|json] [--filter=<name>] [--quick]" << std::endl;
+			std::exit( 1 );
+		}
+	}
+	return options;
+}
+
+} // namespace
+
+int main( int argc, char** argv )
+{
+	Runner runner( parse_options( argc, argv ) );
+
+	// number of strings per batch, so each batch processes roughly the same amount of characters
+	constexpr std::size_t total_chars = 1 << 18;
+
+	for( std::size_t length : {8, 15, 32, 128, 1024, 16384} ) {
+		const auto inputs = make_inputs( length, std::clamp<std::size_t>( total_chars / length, 16, 4096 ) );
+
+		bench_basic_ops<std::string>( runner, inputs, length );
+		bench_basic_ops<shared_string>( runner, inputs, length );
+		bench_basic_ops<const_string>( runner, inputs, length );
+		bench_basic_ops<local_const_string>( runner, inputs, length );
+
+		bench_split_std( runner, inputs, length );
+		bench_split<const_string>( runner, inputs, length );
+		bench_split<local_const_string>( runner, inputs, length );
+
+		bench_concat( runner, inputs, length );
+		bench_zstr( runner, inputs, length );
+	}
+
+	bench_keywords( runner );
+
+	const std::size_t max_threads = std::max( 2u, std::thread::hardware_concurrency() );
+	for( std::size_t threads = 1; threads <= max_threads; threads *= 2 ) {
+		bench_contention( runner, threads );
+	}
+	bench_parallel_split( runner, max_threads );
+	bench_join( runner );
+	bench_string_table( runner );
+
+	runner.finish();
+}
@@ -0,0 +1,82 @@
+#ifndef CONST_STRING_TESTS_HELPERS_HPP
+#define CONST_STRING_TESTS_HELPERS_HPP
+
+#include <const_string/const_string.h>
+
+#include <memory_resource>
+#include <new>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Characters used for the random strings (including all delimiters used by the split tests and benchmarks)
+constexpr std::string_view random_string_alphabet
+	= "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 :/;,.-";
+
+// Generates cnt strings with random length in [0, max_length] (always the same ones for the same arguments)
+inline std::vector<std::string> generate_random_strings( int cnt, int max_length = 1000 )
+{
+	std::mt19937                               rng( 42 );
+	std::uniform_int_distribution<int>         length_dist( 0, max_length );
+	std::uniform_int_distribution<std::size_t> char_dist( 0, random_string_alphabet.size() - 1 );
+
+	std::vector<std::string> ret;
+	ret.reserve( cnt );
+	for( int i = 0; i < cnt; ++i ) {
+		std::string s( static_cast<std::size_t>( length_dist( rng ) ), ' ' );
+		for( auto& c : s ) {
+			c = random_string_alphabet[char_dist( rng )];
+		}
+		ret.push_back( std::move( s ) );
+	}
+	return ret;
+}
+
+inline std::vector<const_string> to_const_strings( const std::vector<std::string>& strings )
+{
+	return std::vector<const_string>( strings.begin(), strings.end() );
+}
+
+/**
+ * Forwards to new_delete_resource, but keeps track of the calls and the size of the last request. If refuse is set,
+ * requests are only recorded and fail with std::bad_alloc (e.g. to check the size of allocations that are too big)
+ */
+class counting_resource : public std::pmr::memory_resource {
+public:
+	int         allocs       = 0;
+	int         deallocs     = 0;
+	std::size_t last_request = 0;
+	bool        refuse       = false;
+
+private:
+	void* do_allocate( std::size_t bytes, std::size_t alignment ) override
+	{
+		last_request = bytes;
+		if( refuse ) {
+			throw std::bad_alloc{};
+		}
+		allocs++;
+		return std::pmr::new_delete_resource()->allocate( bytes, alignment );
+	}
+
+	void do_deallocate( void* p, std::size_t bytes, std::size_t alignment ) override
+	{
+		deallocs++;
+		std::pmr::new_delete_resource()->deallocate( p, bytes, alignment );
+	}
+
+	bool do_is_equal( const std::pmr::memory_resource& other ) const noexcept override { return this == &other; }
+};
+
+template<class T>
+std::vector<T> flatten( const std::vector<std::vector<T>>& v )
+{
+	std::vector<T> ret;
+	for( auto&& e : v ) {
+		ret.insert( ret.end(), e.begin(), e.end() );
+	}
+	return ret;
+}
+
+#endif
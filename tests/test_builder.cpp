@@ -0,0 +1,99 @@
+#include <const_string/const_string_builder.h>
+
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+TEST_CASE( "Builder freezes into const_zstring", "[builder]" )
+{
+	const_string_builder builder;
+	CHECK( builder.freeze() == "" );
+
+	std::string ref;
+	for( int i = 0; i < 1000; ++i ) {
+		builder.append( std::to_string( i ) ).push_back( ',' );
+		ref += std::to_string( i ) + ',';
+	}
+	CHECK( builder.view() == ref );
+	CHECK( builder.capacity() >= builder.size() );
+
+	const auto stats_before = detail::stats();
+
+	const const_zstring str = builder.freeze();
+	// the builder's buffer got handed over (it got shrunk, which might have moved it)
+	CHECK( detail::stats().get_total_allocs() == stats_before.get_total_allocs() + 1 );
+	CHECK( str == ref );
+	CHECK( str.isZeroTerminated() );
+	CHECK( str.get_ref_cnt() == 1 );
+	CHECK( str.hash() == const_string( ref ).hash() );
+	CHECK( builder.empty() );
+	CHECK( builder.capacity() == 0 );
+
+	// the builder can be reused
+	builder += "Hello";
+	builder += ' ';
+	builder.append( 3, '!' );
+	const auto short_str = builder.freeze();
+	CHECK( short_str == "Hello !!!" );
+	CHECK( short_str.get_ref_cnt() == 0 ); // sso
+}
+
+TEST_CASE( "Builder hands over exactly sized buffer", "[builder]" )
+{
+	const std::string ref( 100, 'x' );
+
+	local_const_string_builder builder( ref.size() );
+	builder.append( ref );
+	const char* chars = builder.view().data();
+
+	const local_const_zstring str = builder.freeze();
+	CHECK( str == ref );
+	CHECK( str.data() == chars );
+
+	local_const_string_builder other;
+	other.append( "abc" );
+	other = std::move( builder );
+	CHECK( other.empty() );
+}
+
+TEST_CASE( "Builder appends its own content", "[builder]" )
+{
+	const_string_builder builder;
+	builder.append( builder.view() );
+	CHECK( builder.empty() );
+
+	builder.append( "0123456789" );
+	std::string ref = "0123456789";
+	// the later appends exceed the capacity, so the block has to grow while the source points into it
+	for( int i = 0; i < 10; ++i ) {
+		const auto capacity = builder.capacity();
+		builder.append( builder.view() );
+		ref += ref;
+		CHECK( builder.view() == ref );
+		if( i > 2 ) {
+			CHECK( builder.capacity() > capacity );
+		}
+	}
+
+	builder.append( builder.view().substr( 3, 4 ) );
+	ref += ref.substr( 3, 4 );
+	CHECK( builder.freeze() == ref );
+}
+
+TEST_CASE( "Builder rejects oversized strings", "[builder]" )
+{
+	const_string_builder builder;
+	builder.append( "abc" );
+
+	CHECK_THROWS_AS( builder.reserve( SIZE_MAX ), std::length_error );
+	CHECK_THROWS_AS( builder.reserve( const_string_builder::max_size() + 1 ), std::length_error );
+	CHECK_THROWS_AS( builder.append( SIZE_MAX, 'x' ), std::length_error );
+	CHECK_THROWS_AS( builder.append( const_string_builder::max_size() - 2, 'x' ), std::length_error );
+
+	// the builder is left unchanged
+	CHECK( builder.view() == "abc" );
+	builder.append( 3, '!' );
+	CHECK( builder.freeze() == "abc!!!" );
+}
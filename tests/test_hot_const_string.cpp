@@ -0,0 +1,52 @@
+#include <const_string/hot_const_string.h>
+
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE( "Hot string creates one proxy per thread", "[hot_const_string]" )
+{
+	const const_string str( std::string( 100, 'x' ) );
+	REQUIRE( str.get_ref_cnt() == 1 );
+
+	{
+		const hot_const_string hot( str );
+		CHECK( hot.shared() == str );
+		CHECK( str.get_ref_cnt() == 2 );
+
+		const local_const_string l1 = hot.local();
+		const local_const_string l2 = hot.local();
+		CHECK( l1 == str );
+		CHECK( l1.data() == str.data() );
+		CHECK( l2.data() == str.data() );
+		// only one atomic increment for the proxy of this thread
+		CHECK( str.get_ref_cnt() == 3 );
+
+		// catch assertions aren't thread safe, so the workers only count the mismatches
+		std::atomic_int          mismatch_cnt = 0;
+		std::vector<std::thread> threads;
+		for( int t = 0; t < 4; ++t ) {
+			threads.emplace_back( [&] {
+				for( int i = 0; i < 1000; ++i ) {
+					const local_const_string copy = hot.local();
+					mismatch_cnt += copy.data() != str.data();
+				}
+			} );
+		}
+		for( auto& t : threads ) {
+			t.join();
+		}
+		REQUIRE( mismatch_cnt == 0 );
+		// the proxies of the other threads got released when they exited
+		CHECK( str.get_ref_cnt() == 3 );
+	}
+
+	// this thread's proxy is only released with the next call to local() on a new hot string
+	CHECK( str.get_ref_cnt() == 2 );
+	const hot_const_string other( const_string( "Hello World" ) );
+	CHECK( other.local() == "Hello World" );
+	CHECK( str.get_ref_cnt() == 1 );
+}
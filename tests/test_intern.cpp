@@ -0,0 +1,98 @@
+#include <const_string/intern_table.h>
+
+#include <catch2/catch.hpp>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::literals;
+
+TEST_CASE( "Interned strings share their buffer", "[intern]" )
+{
+	const_string_intern_table table;
+
+	auto s1 = table.intern( "Hello"s );
+	auto s2 = table.intern( std::string_view( "Hello World" ).substr( 0, 5 ) );
+	auto s3 = table.intern( "World"s );
+
+	REQUIRE( s1 == "Hello" );
+	REQUIRE( s1.data() == s2.data() );
+	REQUIRE( s1.data() != s3.data() );
+	REQUIRE( s1.isZeroTerminated() );
+	REQUIRE( table.size() == 2 );
+
+	REQUIRE( table.intern( "" ) == "" );
+	REQUIRE( intern( "Hello"s ).data() == intern( "Hello" ).data() );
+}
+
+TEST_CASE( "Interned strings outlive allocation scopes", "[intern]" )
+{
+	const_string_intern_table table;
+	const std::string         text = "a string that is too long for the small string optimization";
+
+	{
+		const_string_arena            arena;
+		const_string_allocation_scope scope( arena );
+		const auto                    interned = table.intern( text );
+		REQUIRE( interned == text );
+	}
+	// the table must not have kept memory of the destroyed arena
+	const auto again = table.intern( text );
+	REQUIRE( again == text );
+	REQUIRE( table.size() == 1 );
+}
+
+TEST_CASE( "Evict unused interned strings", "[intern]" )
+{
+	const_string_intern_table table;
+
+	auto kept = table.intern( "kept"s );
+	table.intern( "dropped"s );
+	REQUIRE( table.size() == 2 );
+
+	REQUIRE( table.evict_unused() == 1 );
+	REQUIRE( table.size() == 1 );
+	REQUIRE( table.intern( "kept"s ).data() == kept.data() );
+}
+
+TEST_CASE( "Automatic eviction", "[intern]" )
+{
+	const_string_intern_table table( const_string_intern_table::Eviction::Automatic );
+
+	for( int i = 0; i < 100'000; ++i ) {
+		table.intern( std::to_string( i ) );
+	}
+	REQUIRE( table.size() < 100'000 );
+}
+
+TEST_CASE( "Concurrent interning", "[intern]" )
+{
+	const_string_intern_table table;
+
+	constexpr int thread_cnt = 8;
+	constexpr int string_cnt = 1000;
+
+	std::vector<std::vector<const_string>> results( thread_cnt );
+	std::vector<std::thread>               threads;
+	for( int t = 0; t < thread_cnt; ++t ) {
+		threads.emplace_back( [&, t] {
+			for( int i = 0; i < string_cnt; ++i ) {
+				results[t].push_back( table.intern( "string number " + std::to_string( ( i + t * 7 ) % string_cnt ) ) );
+			}
+		} );
+	}
+	for( auto& th : threads ) {
+		th.join();
+	}
+
+	REQUIRE( table.size() == string_cnt );
+	for( int t = 1; t < thread_cnt; ++t ) {
+		for( int i = 0; i < string_cnt; ++i ) {
+			const auto& s = results[t][i];
+			const auto& r = results[0][( i + t * 7 ) % string_cnt];
+			REQUIRE( s == r );
+			REQUIRE( s.data() == r.data() );
+		}
+	}
+}
@@ -0,0 +1,75 @@
+#include <const_string/keyword_switch.h>
+
+#include <catch2/catch.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace const_string_literals;
+
+namespace {
+constexpr auto hello = "Hello"_cs;
+static_assert( hello.size() == 5 );
+static_assert( hello.hash() == detail::string_hash( "Hello" ) );
+static_assert( hello == "Hello" );
+static_assert( const_string_literal( "Hello" ).hash() == hello.hash() );
+
+constexpr auto methods = make_keyword_switch( "GET", "POST", "PUT", "DELETE"_cs, "HEAD" );
+static_assert( methods.size() == 5 );
+static_assert( methods.find( "PUT" ) == 2 );
+static_assert( methods.find( "PATCH" ) == methods.not_found );
+static_assert( methods.index_of( "HEAD" ) == 4 );
+
+int dispatch( const const_string& token )
+{
+	switch( methods.find( token ) ) {
+		case methods.index_of( "GET" ): return 1;
+		case methods.index_of( "POST" ): return 2;
+		case methods.index_of( "DELETE" ): return 3;
+		case methods.not_found: return -1;
+		default: return 0;
+	}
+}
+} // namespace
+
+TEST_CASE( "Compile time string literals", "[const_string_literal]" )
+{
+	const const_string  str  = "Hello World"_cs;
+	const const_zstring zstr = "Hello World"_cs;
+	REQUIRE( str == "Hello World" );
+	REQUIRE( str.get_ref_cnt() == 0 );
+	REQUIRE( zstr.c_str() == str.data() );
+
+	// same hash as at runtime
+	const const_string runtime( std::string( "Hello World" ) );
+	REQUIRE( "Hello World"_cs.hash() == runtime.hash() );
+	REQUIRE( const_string_hash{}( "Hello World"_cs ) == const_string_hash{}( runtime ) );
+	REQUIRE( std::hash<const_string_literal>{}( "Hello World"_cs ) == std::hash<const_string>{}( runtime ) );
+
+	// embedded zeros are part of the literal
+	REQUIRE( "a\0b"_cs.size() == 3 );
+}
+
+TEST_CASE( "Keyword switch", "[const_string_literal]" )
+{
+	REQUIRE( dispatch( const_string( "GET" ) ) == 1 );
+	REQUIRE( dispatch( const_string( "POST" ) ) == 2 );
+	REQUIRE( dispatch( const_string( std::string( "DELETE" ) ) ) == 3 );
+	REQUIRE( dispatch( const_string( "PUT" ) ) == 0 );
+	REQUIRE( dispatch( const_string( "get" ) ) == -1 );
+	REQUIRE( dispatch( const_string( "" ) ) == -1 );
+
+	// a bigger set, looked up with strings that share the cached hash of their buffer
+	constexpr auto keywords = make_keyword_switch( "alpha", "beta", "gamma", "delta", "epsilon", "zeta", "eta",
+												   "theta", "iota", "kappa", "lambda", "mu", "nu", "xi", "omicron",
+												   "pi", "rho", "sigma", "tau", "upsilon", "phi", "chi", "psi",
+												   "omega", "content-length", "content-type", "host", "accept" );
+	for( std::size_t i = 0; i < keywords.size(); ++i ) {
+		const const_string heap = concat( keywords[i].view(), std::string( 20, ' ' ) ).substr( 0, keywords[i].size() );
+		const const_string full( std::string( keywords[i].view() ) + std::string( 20, ' ' ) );
+		CHECK( keywords.find( keywords[i] ) == static_cast<int>( i ) );
+		CHECK( keywords.find( heap ) == static_cast<int>( i ) );
+		CHECK( keywords.find( full ) == keywords.not_found );
+	}
+	CHECK( keywords.find( "omega2" ) == keywords.not_found );
+}
@@ -0,0 +1,132 @@
+#include <const_string/mapped_file.h>
+
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include "helpers.hpp"
+
+namespace {
+struct temp_file {
+	explicit temp_file( const std::string& content )
+		: path( ( std::filesystem::temp_directory_path() / ( "const_string_test_" + std::to_string( cnt++ ) ) ).string() )
+	{
+		std::ofstream( path, std::ios::binary ) << content;
+	}
+	~temp_file() { std::remove( path.c_str() ); }
+
+	std::string path;
+
+	static inline int cnt = 0;
+};
+} // namespace
+
+TEST_CASE( "Map file", "[mapped_file]" )
+{
+	const temp_file file( "Hello World\nThis file is mapped into memory\nLast line" );
+
+	const_string line;
+	{
+		const const_string content = map_file( file.path );
+		REQUIRE( content == "Hello World\nThis file is mapped into memory\nLast line" );
+		CHECK( content.get_ref_cnt() == 1 );
+
+		// zero copy slices
+		const auto lines = content.split_full( '\n' );
+		REQUIRE( lines.size() == 3 );
+		CHECK( lines[1].data() == content.data() + 12 );
+		CHECK( content.substr( 6, 5 ).data() == content.data() + 6 );
+		for( auto l : content.split_lazy( '\n' ) ) {
+			CHECK( l.data() >= content.data() );
+		}
+
+		// the rest of the page is zero filled
+		CHECK( content.isZeroTerminated() );
+		CHECK( content.createZStr().data() == content.data() );
+		CHECK( content.hash() == const_string( std::string_view( content ) ).hash() );
+
+		line = lines[1];
+	}
+	// the slice keeps the mapping alive
+	CHECK( line == "This file is mapped into memory" );
+	CHECK( line.get_ref_cnt() == 1 );
+	CHECK( line.createZStr() == "This file is mapped into memory" );
+}
+
+#ifndef _WIN32
+TEST_CASE( "Map file without zero terminator", "[mapped_file]" )
+{
+	// mapping ends exactly at a page boundary, so there is no readable character behind the content
+	const std::size_t size = static_cast<std::size_t>( ::sysconf( _SC_PAGESIZE ) );
+	const temp_file   file( std::string( size, 'x' ) );
+
+	const const_string content = map_file( file.path );
+	REQUIRE( content.size() == size );
+	CHECK( !content.isZeroTerminated() );
+	CHECK( content.substr( 0, 10 ).isZeroTerminated() == false );
+
+	const auto zstr = content.createZStr();
+	CHECK( zstr == content );
+	CHECK( zstr.data() != content.data() );
+	CHECK( zstr.c_str()[size] == '\0' );
+
+	// conversion to a local string shares the mapping and keeps the information
+	const local_const_string local( content );
+	CHECK( local.data() == content.data() );
+	CHECK( !local.isZeroTerminated() );
+	CHECK( map_file<detail::local_ref_cnt_policy>( file.path ) == content );
+}
+#endif
+
+#if !defined( _WIN32 ) && UINTPTR_MAX > 0xFFFFFFFF
+TEST_CASE( "Copy a mapped file bigger than 4 GiB", "[mapped_file]" )
+{
+	// sparse file: neither the file nor the mapping take up memory, as long as the content isn't read. The size is a
+	// multiple of the page size, so the mapping isn't zero terminated and createZStr has to copy it
+	const std::size_t size = std::size_t( 4 ) << 30;
+	const temp_file   file( "" );
+	std::filesystem::resize_file( file.path, size );
+
+	const const_string content = map_file( file.path );
+	REQUIRE( content.size() == size );
+	REQUIRE( !content.isZeroTerminated() );
+
+	counting_resource res;
+	res.refuse = true;
+	const_string_allocation_scope scope( res );
+	CHECK_THROWS_AS( content.createZStr(), std::bad_alloc );
+	// the full size (plus zero terminator and header) was requested, not one that got truncated to int
+	CHECK( res.last_request > size );
+}
+
+TEST_CASE( "Split a mapped file into more tokens than a reference count can hold", "[mapped_file]" )
+{
+	// a sparse file of 2 GiB zeros has 2^31 + 1 tokens for delimiter '\0'
+	const std::size_t size = std::size_t( 2 ) << 30;
+	const temp_file   file( "" );
+	std::filesystem::resize_file( file.path, size );
+	const const_string content = map_file( file.path );
+
+	// thrown before anything is written
+	CHECK_THROWS_AS( content.split_into( '\0', nullptr, std::numeric_limits<std::size_t>::max() ), std::length_error );
+	// together with the reference content already holds, INT_MAX tokens would overflow the count as well
+	CHECK_THROWS_AS( content.split_into( '\0', nullptr, std::numeric_limits<int>::max() ), std::length_error );
+	CHECK( content.get_ref_cnt() == 1 );
+}
+#endif
+
+TEST_CASE( "Map empty or missing file", "[mapped_file]" )
+{
+	const temp_file file( "" );
+	CHECK( map_file( file.path ).empty() );
+	CHECK( map_file( file.path ).isZeroTerminated() );
+
+	CHECK_THROWS_AS( map_file( file.path + "_does_not_exist" ), std::system_error );
+}
@@ -0,0 +1,78 @@
+#include <const_string/const_string.h>
+
+#include <catch2/catch.hpp>
+
+#include <memory_resource>
+#include <string>
+
+#include "helpers.hpp"
+
+using namespace std::literals;
+
+namespace {
+const std::string long_str = "This string is too long for the small string optimization";
+} // namespace
+
+TEST_CASE( "Construction with memory resource", "[const_string]" )
+{
+	counting_resource res;
+	{
+		const_string cs( long_str, res );
+		REQUIRE( cs == long_str );
+		REQUIRE( cs.isZeroTerminated() );
+		REQUIRE( res.allocs == 1 );
+
+		auto copy = cs.substr( 5 );
+		cs        = const_string{};
+		REQUIRE( res.deallocs == 0 );
+	}
+	REQUIRE( res.deallocs == 1 );
+}
+
+TEST_CASE( "Allocation scope", "[const_string]" )
+{
+	counting_resource res;
+	const_string      outside;
+	{
+		const_string_allocation_scope scope( res );
+
+		const_string cs( long_str );
+		auto         combined = concat( long_str, "!" );
+		REQUIRE( combined == long_str + "!" );
+		REQUIRE( res.allocs == 2 );
+
+		{
+			counting_resource             inner_res;
+			const_string_allocation_scope inner_scope( inner_res );
+			const_string                  inner( long_str );
+			REQUIRE( inner_res.allocs == 1 );
+		}
+		const_string cs2( long_str );
+		REQUIRE( res.allocs == 3 );
+	}
+	REQUIRE( res.deallocs == 3 );
+
+	outside = const_string( long_str );
+	REQUIRE( res.allocs == 3 );
+}
+
+TEST_CASE( "Arena", "[const_string]" )
+{
+	counting_resource upstream;
+	{
+		const_string_arena arena( &upstream );
+		{
+			const_string cs( long_str, arena );
+			REQUIRE( cs == long_str );
+
+			const_string_allocation_scope scope( arena );
+			for( int i = 0; i < 100; ++i ) {
+				auto tmp = concat( long_str, std::to_string( i ) );
+				REQUIRE( tmp.size() > long_str.size() );
+			}
+		}
+		REQUIRE( upstream.allocs > 0 );
+		REQUIRE( upstream.deallocs == 0 );
+	}
+	REQUIRE( upstream.deallocs == upstream.allocs );
+}
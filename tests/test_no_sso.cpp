@@ -0,0 +1,66 @@
+// Compiled with CONST_STRING_SSO_CAPACITY=0 (in its own executable, as the define changes the layout of const_string)
+#include <const_string/const_string.h>
+
+#include <catch2/catch.hpp>
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+
+static_assert( const_string::sso_capacity == 0 );
+
+namespace {
+// whether str points into the object owner (i.e. would dangle once owner is gone)
+template<class T>
+bool points_into( const T& owner, std::string_view str )
+{
+	const auto begin = reinterpret_cast<const char*>( &owner );
+	return begin <= str.data() && str.data() < begin + sizeof( owner );
+}
+} // namespace
+
+TEST_CASE( "Empty strings without sso don't point into their source", "[no_sso]" )
+{
+	const std::string    empty;
+	const const_zstring original( empty );
+	CHECK( original.empty() );
+	CHECK( original.isZeroTerminated() );
+	CHECK( !points_into( original, original ) );
+
+	const_zstring copy( original );
+	CHECK( !points_into( original, copy ) );
+	CHECK( !points_into( copy, copy ) );
+
+	const_zstring assigned;
+	assigned = original;
+	CHECK( !points_into( original, assigned ) );
+
+	const_zstring moved( std::move( copy ) );
+	CHECK( !points_into( copy, moved ) );
+	CHECK( moved.c_str()[0] == '\0' );
+
+	const local_const_string converted( original );
+	CHECK( !points_into( original, converted ) );
+	CHECK( converted.empty() );
+
+	CHECK( const_string( std::string() ).empty() );
+	CHECK( concat( original, original ).c_str()[0] == '\0' );
+	CHECK( const_string( "text" ).substr( 2, 0 ).empty() );
+}
+
+TEST_CASE( "Short strings without sso are heap allocated", "[no_sso]" )
+{
+	const const_zstring str( std::string( "a" ) );
+	CHECK( str.get_ref_cnt() == 1 );
+
+	const_zstring copy( str );
+	CHECK( copy.data() == str.data() );
+	CHECK( str.get_ref_cnt() == 2 );
+	CHECK( concat( str, copy ) == "aa" );
+
+	char* const buffer = static_cast<char*>( std::malloc( 1 ) );
+	const auto  empty  = const_string::adopt( buffer, 0, []( char* data ) { std::free( data ); } );
+	CHECK( empty.empty() );
+	CHECK( !points_into( empty, empty ) );
+}
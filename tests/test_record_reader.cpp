@@ -0,0 +1,124 @@
+#include <const_string/record_reader.h>
+
+#include <catch2/catch.hpp>
+
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#ifndef _WIN32
+#include <thread>
+#include <unistd.h>
+#endif
+
+static_assert( !std::is_copy_constructible_v<record_reader> && !std::is_copy_assignable_v<record_reader> );
+static_assert( std::is_move_constructible_v<record_reader> && std::is_move_assignable_v<record_reader> );
+
+namespace {
+template<class Reader>
+std::vector<const_string> read_all( Reader&& reader )
+{
+	std::vector<const_string> ret;
+	const_string              record;
+	while( reader.next( record ) ) {
+		ret.push_back( record );
+	}
+	CHECK( record.empty() );
+	return ret;
+}
+} // namespace
+
+TEST_CASE( "Read records from stream", "[record_reader]" )
+{
+	std::string input;
+	for( int i = 0; i < 500; ++i ) {
+		input += "line " + std::to_string( i ) + std::string( i % 50, 'x' ) + '\n';
+	}
+	input += std::string( 300, 'y' ); // long last record without delimiter
+	const auto ref = const_string( input ).split_full( '\n' );
+
+	for( std::size_t chunk_size : {1, 7, 64, 1000, 1 << 20} ) {
+		std::istringstream in( input );
+		CHECK( read_all( record_reader( in, '\n', chunk_size ) ) == ref );
+	}
+
+	// records of one chunk share its buffer
+	std::istringstream in( input );
+	const auto         records = read_all( record_reader( in ) );
+	REQUIRE( records.size() == ref.size() );
+	CHECK( records[1].data() == records[0].data() + records[0].size() + 1 );
+	CHECK( records[0].get_ref_cnt() == static_cast<int>( records.size() ) ); // reader is gone already
+}
+
+TEST_CASE( "Read records with custom delimiter", "[record_reader]" )
+{
+	std::istringstream  in( "a;bb;;ccc;" );
+	local_record_reader reader( in, ';', 4 );
+
+	local_const_string record;
+	std::vector<local_const_string> records;
+	while( reader.next( record ) ) {
+		records.push_back( record );
+	}
+	CHECK( records == std::vector<local_const_string>{"a", "bb", "", "ccc"} );
+
+	std::istringstream empty( "" );
+	CHECK( read_all( record_reader( empty ) ).empty() );
+}
+
+TEST_CASE( "Use record reader after move", "[record_reader]" )
+{
+	std::istringstream in( "first\nsecond\nthird\nfourth\n" );
+	record_reader      reader( in, '\n', 8 );
+
+	const_string record;
+	REQUIRE( reader.next( record ) );
+	CHECK( record == "first" );
+
+	// the moved from reader doesn't hand out records of the chunk it no longer owns
+	record_reader moved( std::move( reader ) );
+	CHECK( !reader.next( record ) );
+	CHECK( record.empty() );
+	REQUIRE( moved.next( record ) );
+	CHECK( record == "second" );
+
+	std::istringstream other_in( "other\n" );
+	reader = record_reader( other_in );
+	REQUIRE( reader.next( record ) );
+	CHECK( record == "other" );
+
+	reader = std::move( moved );
+	CHECK( !moved.next( record ) );
+	CHECK( read_all( reader ) == std::vector<const_string>{"third", "fourth"} );
+}
+
+#ifndef _WIN32
+TEST_CASE( "Read records from file descriptor", "[record_reader]" )
+{
+	int fds[2];
+	REQUIRE( ::pipe( fds ) == 0 );
+
+	std::string input;
+	for( int i = 0; i < 10000; ++i ) {
+		input += std::to_string( i ) + '\n';
+	}
+
+	// catch assertions aren't thread safe, so the writer only records whether all writes succeeded
+	bool        written = true;
+	std::thread writer( [&] {
+		for( std::size_t pos = 0; pos < input.size(); pos += 1000 ) {
+			const auto part = std::string_view( input ).substr( pos, 1000 );
+			written = written && ::write( fds[1], part.data(), part.size() ) == static_cast<ssize_t>( part.size() );
+		}
+		::close( fds[1] );
+	} );
+
+	const auto records = read_all( record_reader( fds[0], '\n', 4096 ) );
+	writer.join();
+	::close( fds[0] );
+
+	CHECK( written );
+	CHECK( records == const_string( input ).split_full( '\n' ) );
+}
+#endif
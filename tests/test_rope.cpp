@@ -0,0 +1,75 @@
+#include <const_string/const_rope.h>
+
+#include <catch2/catch.hpp>
+
+#include <string>
+
+using namespace std::literals;
+
+TEST_CASE( "Rope shares its pieces", "[rope]" )
+{
+	const const_string header( "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n"s );
+	const const_string body( "This body is long enough to not be stored inline"s );
+
+	const_rope rope;
+	rope += header;
+	rope += const_string( "\r\n" );
+	rope += const_string{};
+	rope += body;
+
+	CHECK( rope.size() == header.size() + 2 + body.size() );
+	REQUIRE( rope.chunks().size() == 3 );
+	CHECK( rope.chunks()[0].data() == header.data() );
+	CHECK( rope.chunks()[2].data() == body.data() );
+	CHECK( body.get_ref_cnt() == 2 );
+
+	std::string gathered;
+	for( const auto& chunk : rope ) {
+		gathered += chunk;
+	}
+	CHECK( rope == gathered );
+	CHECK( rope != "HTTP" );
+
+	const const_zstring flat = rope.flatten();
+	CHECK( flat == gathered );
+	CHECK( flat.isZeroTerminated() );
+	CHECK( flat.c_str()[flat.size()] == '\0' );
+}
+
+TEST_CASE( "Flatten rope", "[rope]" )
+{
+	CHECK( const_rope{}.flatten() == "" );
+	CHECK( const_rope{}.empty() );
+
+	// a single zero terminated piece is returned as is
+	const const_string piece( "A single piece that is too long for sso"s );
+	CHECK( const_rope( piece ).flatten().data() == piece.data() );
+
+	// short result
+	const auto short_rope = const_rope( const_string( "ab" ) ) + const_string( "cd" );
+	CHECK( short_rope.flatten() == "abcd" );
+
+	const auto combined = short_rope + short_rope + const_rope( piece );
+	CHECK( combined.chunks().size() == 5 );
+	CHECK( combined.flatten() == "abcdabcd" + std::string( piece ) );
+
+	local_const_rope local( local_const_string( "local" ) );
+	local += local_const_string( " rope" );
+	CHECK( local.flatten() == "local rope" );
+}
+
+TEST_CASE( "Append rope to itself", "[rope]" )
+{
+	const const_string piece( "A piece that is too long for the sso buffer"s );
+
+	const_rope rope( piece );
+	rope += const_string( "|" );
+	rope += rope;
+	rope.append( rope );
+
+	CHECK( rope.size() == 4 * ( piece.size() + 1 ) );
+	REQUIRE( rope.chunks().size() == 8 );
+	CHECK( rope.chunks()[6].data() == piece.data() );
+	const std::string quarter = std::string( piece ) + '|';
+	CHECK( rope.flatten() == quarter + quarter + quarter + quarter );
+}
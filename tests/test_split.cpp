@@ -1,12 +1,19 @@
 #include <const_string/const_string.h>
+#include <const_string/const_string_vector.h>
 
 #include <catch2/catch.hpp>
 
 #include <algorithm>
+#include <cctype>
 #include <iostream>
+#include <iterator>
+#include <string>
+#include <type_traits>
 
 #include "helpers.hpp"
 
+using namespace std::literals;
+
 TEST_CASE( "Split Position" )
 {
 	const_string s( "Hello World" );
@@ -194,3 +201,261 @@ TEST_CASE( "Fuzzy Split" )
 		cstrings = flatten( tmp );
 	}
 }
+
+TEST_CASE( "Split any of" )
+{
+	const_string s( "Hello my:dear!/How;are,,you?"s );
+
+	const auto words = s.split_full_any_of( " :/;," );
+
+	std::vector<const_string> ref{"Hello", "my", "dear!", "How", "are", "", "you?"};
+	CHECK( words == ref );
+
+	CHECK( const_string( "a:b"s ).split_full_any_of( ":" ) == const_string( "a:b"s ).split_full( ':' ) );
+	CHECK( s.split_full_any_of( "" ) == std::vector<const_string>{s} );
+}
+
+TEST_CASE( "Split long strings with many delimiters" )
+{
+	// exercises the block wise scanning incl. partial blocks and large delimiter sets
+	std::string base;
+	std::string all_delims;
+	for( int i = 0; i < 1000; ++i ) {
+		base += std::to_string( i );
+		base += " :/;,"[i % 5];
+	}
+	for( int c = 0; c < 256; ++c ) {
+		if( !std::isalnum( c ) ) {
+			all_delims += static_cast<char>( c );
+		}
+	}
+	const_string s( base );
+
+	std::vector<const_string> ref;
+	std::size_t               start = 0;
+	for( std::size_t i = 0; i < base.size(); ++i ) {
+		if( std::string_view( " :/;," ).find( base[i] ) != std::string_view::npos ) {
+			ref.push_back( s.substr( start, i - start ) );
+			start = i + 1;
+		}
+	}
+	CHECK( s.split_full_any_of( " :/;," ) == ref );
+	CHECK( s.split_full_any_of( all_delims ) == ref );
+
+	std::vector<const_string> lazy;
+	for( auto w : s.split_lazy( ' ' ) ) {
+		lazy.push_back( w );
+	}
+	CHECK( lazy == s.split_full( ' ' ) );
+}
+
+TEST_CASE( "Split lazy variants" )
+{
+	const_string s( "Hello, my dear,, how are you?, "s );
+
+	auto to_vector = []( auto&& range ) { return std::vector<const_string>( range.begin(), range.end() ); };
+
+	CHECK( to_vector( s.split_lazy( ", " ) ) == std::vector<const_string>{"Hello", "my dear,", "how are you?"} );
+	CHECK( to_vector( s.split_lazy( ',' ) ) == s.split_full( ',' ) );
+	CHECK( to_vector( s.split_lazy_any_of( " ," ) ) == s.split_full_any_of( " ," ) );
+	CHECK( to_vector( s.split_lazy_any_of( " ,", const_string::EmptyTokens::Skip ) )
+		   == std::vector<const_string>{"Hello", "my", "dear", "how", "are", "you?"} );
+	CHECK( to_vector( s.split_lazy( "" ) ) == std::vector<const_string>{s} );
+	CHECK( to_vector( const_string{}.split_lazy( ' ' ) ).empty() );
+	CHECK( to_vector( const_string( ",,," ).split_lazy( ',', const_string::EmptyTokens::Skip ) ).empty() );
+
+	// the view keeps the string alive
+	std::vector<const_string> words;
+	for( auto w : const_string( std::string( "This string is too long for sso" ) ).split_lazy( ' ' ) ) {
+		words.push_back( w );
+	}
+	CHECK( words == std::vector<const_string>{"This", "string", "is", "too", "long", "for", "sso"} );
+}
+
+TEST_CASE( "Split view iterator" )
+{
+	using It = const_string::split_view::iterator;
+	static_assert( std::is_same_v<std::iterator_traits<It>::value_type, const_string> );
+	static_assert( std::is_default_constructible_v<It> );
+
+	const_string s( "a b c d"s );
+	auto         view = s.split_lazy( ' ' );
+	CHECK( std::distance( view.begin(), view.end() ) == 4 );
+
+	auto it   = view.begin();
+	auto copy = it++;
+	CHECK( *copy == "a" );
+	CHECK( *it == "b" );
+	CHECK( *it == "b" ); // dereferencing doesn't advance
+	CHECK( copy != it );
+	CHECK( ++copy == it );
+	CHECK( std::find( view.begin(), view.end(), "d" ) != view.end() );
+}
+
+TEST_CASE( "Split into caller supplied storage" )
+{
+	const std::string long_text = "This string is too long for sso, so the tokens share its buffer";
+	for( const_string s : {const_string( "a,b,,c"s ), const_string( long_text )} ) {
+		const auto ref = s.split_full( ',' );
+
+		CHECK( s.count_tokens( ',' ) == ref.size() );
+		CHECK( s.split_full( ',', const_string::Reserve::Exact ) == ref );
+
+		std::vector<const_string> out{"prefix"};
+		s.split_into( ',', out, const_string::Reserve::Exact );
+		REQUIRE( out.size() == ref.size() + 1 );
+		CHECK( out.capacity() == out.size() );
+		CHECK( std::equal( ref.begin(), ref.end(), out.begin() + 1 ) );
+
+		const_string      arr[2];
+		const std::size_t cnt = s.split_into( ',', arr, 2 );
+		CHECK( cnt == ref.size() );
+		CHECK( arr[0] == ref[0] );
+		CHECK( arr[1] == ref[1] );
+	}
+
+	const_string s( long_text );
+	{
+		const_string arr[20];
+		CHECK( s.split_into( ' ', arr, 20 ) == 13 );
+		CHECK( s.get_ref_cnt() == 14 );
+	}
+	CHECK( s.get_ref_cnt() == 1 );
+
+	CHECK( const_string{}.count_tokens( ' ' ) == 0 );
+	CHECK( const_string( ",,," ).count_tokens( ',' ) == 3 );
+	CHECK( const_string( "a:b/c/" ).count_tokens_any_of( ":/" ) == 3 );
+
+	std::string many( 1000, 'x' );
+	for( std::size_t i = 0; i < many.size(); i += 7 ) {
+		many[i] = ';';
+	}
+	CHECK( const_string( many ).count_tokens( ';' ) == const_string( many ).split_full( ';' ).size() );
+}
+
+TEST_CASE( "Slice batch" )
+{
+	const_string s( std::string( "key1=value1;key2=value2;key3=value3" ) );
+
+	// e.g. ranges found by a custom parser
+	std::vector<std::string_view> ranges;
+	const std::string_view        sv = s;
+	for( std::size_t pos = 0; pos < sv.size(); pos += 12 ) {
+		ranges.push_back( sv.substr( pos, 4 ) );
+		ranges.push_back( sv.substr( pos + 5, 6 ) );
+	}
+
+	{
+		const auto parts = s.slices( ranges );
+		CHECK( parts == std::vector<const_string>{"key1", "value1", "key2", "value2", "key3", "value3"} );
+		CHECK( parts[1].data() == s.data() + 5 );
+		CHECK( s.get_ref_cnt() == 7 );
+
+		std::vector<const_string> more;
+		s.slices_into( std::vector<std::string_view>{sv.substr( 0, 4 )}, more );
+		CHECK( more == std::vector<const_string>{"key1"} );
+		CHECK( s.get_ref_cnt() == 8 );
+	}
+	CHECK( s.get_ref_cnt() == 1 );
+
+	const_string           short_str( "a=b" );
+	const std::string_view short_sv = short_str;
+	const auto             short_parts
+		= short_str.slices( std::vector<std::string_view>{short_sv.substr( 0, 1 ), short_sv.substr( 2 )} );
+	CHECK( short_parts == std::vector<const_string>{"a", "b"} );
+}
+
+TEMPLATE_TEST_CASE( "Parallel split", "", const_string, local_const_string )
+{
+	// big enough to be split into several chunks
+	std::string input;
+	for( const auto& s : generate_random_strings( 3000 ) ) {
+		input += s;
+	}
+	input = ",," + input + ",,";
+	REQUIRE( input.size() > 4 * TestType::parallel_split_min_chunk );
+
+	const TestType str( input );
+	const auto     expected = str.split_full( ',' );
+	REQUIRE( str.get_ref_cnt() == static_cast<int>( expected.size() + 1 ) );
+
+	for( std::size_t threads : {0, 1, 2, 3, 4, 16} ) {
+		const auto tokens = str.split_full_parallel( ',', threads );
+		REQUIRE( tokens == expected );
+		REQUIRE( tokens.front().data() == str.data() );
+		REQUIRE( str.get_ref_cnt() == static_cast<int>( 2 * expected.size() + 1 ) );
+	}
+	REQUIRE( str.get_ref_cnt() == static_cast<int>( expected.size() + 1 ) );
+
+	// chunks without any delimiter
+	const TestType no_delim( std::string( 3 * TestType::parallel_split_min_chunk, 'x' ) );
+	REQUIRE( no_delim.split_full_parallel( ',', 4 ) == no_delim.split_full( ',' ) );
+
+	// small strings are split on the calling thread
+	REQUIRE( TestType( "a,b,,c" ).split_full_parallel( ',', 4 ) == TestType( "a,b,,c" ).split_full( ',' ) );
+}
+
+TEMPLATE_TEST_CASE( "Flat split", "", const_string, local_const_string )
+{
+	using Vector_t = decltype( split_full_flat( TestType(), ',' ) );
+	using It       = typename Vector_t::view_iterator;
+	// dereferencing returns a temporary, which only input iterators may do
+	static_assert( std::is_same_v<typename std::iterator_traits<It>::iterator_category, std::input_iterator_tag> );
+	static_assert( std::is_same_v<typename It::iterator_concept, std::random_access_iterator_tag> );
+
+	std::string input;
+	for( const auto& s : generate_random_strings( 100 ) ) {
+		input += s;
+	}
+	input = ",," + input + ",,";
+
+	const TestType str( input );
+	for( auto reserve : {TestType::Reserve::None, TestType::Reserve::Exact} ) {
+		const auto expected = str.split_full( ',' );
+		const auto tokens   = split_full_flat( str, ',', reserve );
+		// all tokens share a single reference
+		REQUIRE( str.get_ref_cnt() == static_cast<int>( expected.size() + 2 ) );
+
+		REQUIRE( tokens.size() == expected.size() );
+		REQUIRE( std::equal( tokens.begin(), tokens.end(), expected.begin(), expected.end() ) );
+		REQUIRE( tokens.to_vector() == expected );
+		for( std::size_t i = 0; i < tokens.size(); ++i ) {
+			REQUIRE( tokens.view( i ).data() == expected[i].data() );
+			REQUIRE( tokens[i] == expected[i] );
+		}
+		CHECK( tokens.at( 1 ) == expected[1] );
+		CHECK_THROWS_AS( tokens.at( tokens.size() ), std::out_of_range );
+		CHECK( tokens.end() - tokens.begin() == static_cast<std::ptrdiff_t>( tokens.size() ) );
+		CHECK( tokens.begin()[2] == expected[2] );
+		CHECK( *( tokens.end() - 1 ) == expected.back() );
+	}
+	REQUIRE( str.get_ref_cnt() == 1 );
+
+	// sso strings: the tokens point into the vector's own copy, which is still valid after moving the vector
+	Vector_t short_tokens = split_full_flat( TestType( "a,bc,,d" ), ',' );
+	const Vector_t moved  = std::move( short_tokens );
+	REQUIRE( moved.size() == 4 );
+	CHECK( moved.view( 1 ) == "bc" );
+	CHECK( moved[3] == "d" );
+	CHECK( moved.view( 2 ).empty() );
+	CHECK( moved.view( 1 ).data() == moved.parent().data() + 2 );
+
+	CHECK( split_full_flat( TestType(), ',' ).empty() );
+	CHECK( Vector_t().begin() == Vector_t().end() );
+}
+
+TEST_CASE( "Filling a const_string_vector manually" )
+{
+	const const_string  str( "key1=value1;key2=value2;key3=value3" );
+	const_string_vector values( str );
+	for( const auto& token : str.split_lazy( ';' ) ) {
+		const std::string_view sv = token;
+		values.push_back( sv.substr( sv.find( '=' ) + 1 ) );
+	}
+	CHECK( std::vector<std::string_view>( values.begin(), values.end() )
+		   == std::vector<std::string_view>{"value1", "value2", "value3"} );
+	CHECK( values[2].data() == str.data() + str.size() - 6 );
+
+	values.clear();
+	CHECK( values.empty() );
+}
@@ -0,0 +1,188 @@
+#include <const_string/string_table.h>
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+namespace {
+std::vector<const_string> sample_strings()
+{
+	std::vector<const_string> ret;
+	for( int i = 0; i < 200; ++i ) {
+		ret.emplace_back( "String number " + std::to_string( i % 50 ) + " with some padding to avoid sso" );
+	}
+	ret.emplace_back( "" );
+	ret.emplace_back( "short" );
+	return ret;
+}
+
+std::string write_table( const std::vector<const_string>& strings, string_table::Dedup dedup )
+{
+	std::ostringstream out;
+	string_table::write( out, strings, dedup );
+	return out.str();
+}
+} // namespace
+
+TEST_CASE( "String table round trip", "[string_table]" )
+{
+	const auto strings = sample_strings();
+
+	for( auto dedup : {string_table::Dedup::No, string_table::Dedup::Yes} ) {
+		std::istringstream in( write_table( strings, dedup ) );
+		const auto         table = string_table::read( in );
+
+		REQUIRE( table.size() == strings.size() );
+		CHECK( !table.empty() );
+		for( std::size_t i = 0; i < strings.size(); ++i ) {
+			CHECK( table.view( i ) == strings[i] );
+			CHECK( table[i] == strings[i] );
+		}
+		CHECK( std::equal( table.begin(), table.end(), strings.begin(), strings.end() ) );
+		CHECK( table.to_vector() == strings );
+		// the strings are zero terminated in the buffer
+		CHECK( table.view( 0 ).data()[table.view( 0 ).size()] == '\0' );
+	}
+}
+
+TEST_CASE( "String table iterator", "[string_table]" )
+{
+	using It = string_table::view_iterator;
+	// dereferencing returns a temporary, which only input iterators may do
+	static_assert( std::is_same_v<std::iterator_traits<It>::iterator_category, std::input_iterator_tag> );
+	static_assert( std::is_same_v<It::iterator_concept, std::forward_iterator_tag> );
+	static_assert( std::is_same_v<std::iterator_traits<It>::value_type, std::string_view> );
+
+	std::istringstream in( write_table( sample_strings(), string_table::Dedup::Yes ) );
+	const auto         table = string_table::read( in );
+	CHECK( std::distance( table.begin(), table.end() ) == static_cast<std::ptrdiff_t>( table.size() ) );
+	CHECK( *std::next( table.begin(), 3 ) == table.view( 3 ) );
+}
+
+TEST_CASE( "String table dedup stores equal strings once", "[string_table]" )
+{
+	const auto strings = sample_strings();
+
+	const auto plain   = write_table( strings, string_table::Dedup::No );
+	const auto deduped = write_table( strings, string_table::Dedup::Yes );
+	CHECK( deduped.size() < plain.size() );
+
+	std::istringstream in( deduped );
+	const auto         table = string_table::read( in );
+	REQUIRE( table.size() == strings.size() );
+	CHECK( table.view( 0 ).data() == table.view( 50 ).data() );
+	CHECK( table.view( 0 ).data() != table.view( 1 ).data() );
+}
+
+TEST_CASE( "String table hands out slices without allocations", "[string_table]" )
+{
+	const auto         strings = sample_strings();
+	std::istringstream in( write_table( strings, string_table::Dedup::Yes ) );
+	const auto         table = string_table::read( in );
+
+	const auto  allocs_before = detail::stats().get_total_allocs();
+	const auto  vec           = table.to_vector();
+	const auto& buffer        = table.buffer();
+	for( const auto& str : vec ) {
+		if( str.size() > const_string::sso_capacity ) {
+			CHECK( buffer.data() <= str.data() );
+			CHECK( str.data() + str.size() <= buffer.data() + buffer.size() );
+		}
+	}
+	CHECK( table[3].data() == vec[3].data() );
+	CHECK( detail::stats().get_total_allocs() == allocs_before );
+}
+
+TEST_CASE( "Load string table from file", "[string_table]" )
+{
+	const auto strings = sample_strings();
+	const auto path    = ( std::filesystem::temp_directory_path() / "const_string_test_table.cstb" ).string();
+	{
+		std::ofstream out( path, std::ios::binary );
+		string_table::write( out, strings );
+	}
+
+	std::vector<local_const_string> loaded;
+	{
+		const auto table = local_string_table::load( path );
+		REQUIRE( table.size() == strings.size() );
+		for( std::size_t i = 0; i < table.size(); ++i ) {
+			loaded.emplace_back( table[i] );
+		}
+	}
+	// the strings keep the mapping alive
+	CHECK( std::equal( loaded.begin(), loaded.end(), strings.begin(), strings.end() ) );
+
+	std::remove( path.c_str() );
+	CHECK_THROWS_AS( string_table::load( path ), std::system_error );
+}
+
+TEST_CASE( "Moved string table", "[string_table]" )
+{
+	// small enough to be stored inline with a big CONST_STRING_SSO_CAPACITY
+	const std::vector<const_string> strings{const_string( "ab" ), const_string( "c" )};
+
+	std::istringstream in( write_table( strings, string_table::Dedup::Yes ) );
+	string_table       table = string_table::read( in );
+	string_table       moved( std::move( table ) );
+	string_table       assigned;
+	assigned = std::move( moved );
+	REQUIRE( assigned.size() == 2 );
+	CHECK( assigned.view( 0 ) == "ab" );
+	CHECK( assigned[1] == "c" );
+}
+
+TEST_CASE( "Empty string table", "[string_table]" )
+{
+	const string_table empty;
+	CHECK( empty.size() == 0 );
+	CHECK( empty.empty() );
+	CHECK( empty.begin() == empty.end() );
+
+	std::istringstream in( write_table( {}, string_table::Dedup::Yes ) );
+	const auto         table = string_table::read( in );
+	CHECK( table.empty() );
+	CHECK( table.to_vector().empty() );
+}
+
+TEST_CASE( "Invalid string tables are rejected", "[string_table]" )
+{
+	const auto data = write_table( sample_strings(), string_table::Dedup::Yes );
+
+	CHECK_THROWS_AS( string_table( const_string( "" ) ), std::runtime_error );
+	CHECK_THROWS_AS( string_table( const_string( "not a string table, just some text of similar length" ) ),
+					 std::runtime_error );
+
+	// truncated
+	CHECK_THROWS_AS( string_table( const_string( data.substr( 0, data.size() - 1 ) ) ), std::runtime_error );
+	CHECK_THROWS_AS( string_table( const_string( data.substr( 0, 40 ) ) ), std::runtime_error );
+
+	// unsupported version
+	auto wrong_version = data;
+	wrong_version[4]   = 2;
+	CHECK_THROWS_AS( string_table( const_string( wrong_version ) ), std::runtime_error );
+
+	// offset out of order (the second offset is overwritten with a large value)
+	auto bad_offset        = data;
+	bad_offset[40 + 8 + 6] = 1;
+	CHECK_THROWS_AS( string_table( const_string( bad_offset ) ), std::runtime_error );
+
+	// id out of range (the first id follows the 52 + 1 offsets of the 52 unique strings)
+	auto bad_id             = data;
+	bad_id[40 + 8 * 53 + 3] = 1;
+	CHECK_THROWS_AS( string_table( const_string( bad_id ) ), std::runtime_error );
+
+	// missing terminator
+	auto no_terminator   = data;
+	no_terminator.back() = 'x';
+	CHECK_THROWS_AS( string_table( const_string( no_terminator ) ), std::runtime_error );
+}
@@ -1,10 +1,27 @@
+#include <const_string/const_rope.h>
 #include <const_string/const_string.h>
+#include <const_string/mapped_file.h>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
 #include <string>
 #include <thread>
+#include <unordered_map>
 
 #include <catch2/catch.hpp>
 
+#include "helpers.hpp"
+
 using namespace std::literals;
 
 void requireZero( std::string_view view )
@@ -120,6 +137,96 @@ TEST_CASE( "concat", "[const_string]" )
 	requireZero( combined );
 }
 
+TEST_CASE( "concat with numbers and formatted values", "[const_string]" )
+{
+	REQUIRE( concat( "key=", 42 ) == "key=42" );
+	REQUIRE( concat( 1, '+', 2u, '=', 3ll ) == "1+2=3" );
+	REQUIRE( concat( "min=", std::numeric_limits<std::int64_t>::min() ) == "min=-9223372036854775808" );
+	REQUIRE( concat( "max=", std::numeric_limits<std::uint64_t>::max() ) == "max=18446744073709551615" );
+	REQUIRE( concat( true, "/", false ) == "true/false" );
+	REQUIRE( concat( "x=", 0.5, " y=", -2.25f ) == "x=0.5 y=-2.25" );
+	REQUIRE( concat( "pi=", 3.14159 ) == "pi=3.14159" );
+
+	REQUIRE( concat( concat_fmt::hex( 255 ) ) == "ff" );
+	REQUIRE( concat( "0x", concat_fmt::hex( 0xbeefu, 8 ) ) == "0x0000beef" );
+	REQUIRE( concat( '[', concat_fmt::pad( 42, 5 ), ']' ) == "[   42]" );
+	REQUIRE( concat( '[', concat_fmt::pad( -42, 5, '0' ), ']' ) == "[-0042]" );
+	REQUIRE( concat( '[', concat_fmt::pad( 123456, 3 ), ']' ) == "[123456]" );
+	REQUIRE( concat( '[', concat_fmt::pad( "abc", 6, '.' ), ']' ) == "[...abc]" );
+	REQUIRE( concat( '[', concat_fmt::pad( const_string( "abc" ), 2 ), ']' ) == "[abc]" );
+	REQUIRE( concat( concat_fmt::fixed( 2.0 / 3.0, 2 ) ) == "0.67" );
+	REQUIRE( concat( concat_fmt::fixed( 1.5, 3, 8 ) ) == "   1.500" );
+	REQUIRE( concat( concat_fmt::fixed( 1e300, 2 ) ) == "1.00e+300" );
+
+	// long results are allocated once and are zero terminated
+	const auto stats_before = detail::stats();
+	const auto line         = concat( "2024-01-01 ", concat_fmt::pad( 7, 2, '0' ), ":", 3.5, " request id=",
+									  concat_fmt::hex( 0xdeadbeefu ), " size=", 1234567 );
+	REQUIRE( line == "2024-01-01 07:3.5 request id=deadbeef size=1234567" );
+	REQUIRE( detail::stats().get_total_allocs() == stats_before.get_total_allocs() + 1 );
+	requireZero( line );
+}
+
+TEST_CASE( "concat and join ranges", "[const_string]" )
+{
+	const std::vector<const_string> vec{"Hello", const_string( "World"s ), "How are you?"};
+	REQUIRE( concat( vec ) == "HelloWorldHow are you?" );
+	REQUIRE( join( vec, ", " ) == "Hello, World, How are you?" );
+	requireZero( join( vec, ", " ) );
+	REQUIRE( join( vec, "" ) == concat( vec ) );
+
+	const std::deque<std::string>         deq{"a", "b", "c"};
+	const std::array<std::string_view, 2> arr{"x", "y"};
+	REQUIRE( concat( deq ) == "abc" );
+	REQUIRE( join( deq, "--" ) == "a--b--c" );
+	REQUIRE( join( arr, "+" ) == "x+y" );
+	REQUIRE( join( std::vector<std::string>{}, "," ) == "" );
+	REQUIRE( join( std::vector<std::string>{"single"}, "," ) == "single" );
+
+	const_rope rope( "Hello" );
+	rope += " big ";
+	rope += const_string( std::string( 100, 'r' ) );
+	REQUIRE( concat( rope.chunks() ) == rope.flatten() );
+
+	// enough characters to be copied on several threads (also splits single strings between threads)
+	std::vector<std::string> big;
+	std::string              expected;
+	for( const auto& s : { 3'000'000u, 10u, 0u, 9'000'000u, 1u, 5'000'000u, 2'000'000u} ) {
+		big.push_back( std::string( s, static_cast<char>( 'a' + big.size() ) ) );
+		expected += ( big.size() > 1 ? "<->" : "" ) + big.back();
+	}
+	REQUIRE( expected.size() >= const_zstring::parallel_concat_min_size );
+	for( std::size_t threads : {0, 1, 2, 3, 4} ) {
+		const auto joined = join( big, "<->", threads );
+		REQUIRE( joined == expected );
+		requireZero( joined );
+	}
+	REQUIRE( concat( big ).size() == expected.size() - 6 * 3 );
+}
+
+#if !defined( _WIN32 ) && UINTPTR_MAX > 0xFFFFFFFF
+TEST_CASE( "concat and join to more than 4 GiB", "[const_string]" )
+{
+	// mapping a sparse file provides 2 GiB of characters without taking up memory (as long as they aren't read)
+	const std::size_t size = std::size_t( 2 ) << 30;
+	const std::string path = ( std::filesystem::temp_directory_path() / "const_string_test_concat" ).string();
+	std::ofstream( path, std::ios::binary ).close();
+	std::filesystem::resize_file( path, size );
+	const const_string content = map_file( path );
+	std::remove( path.c_str() );
+
+	// the full size (plus zero terminator and header) is requested, not one that got truncated to int
+	counting_resource res;
+	res.refuse = true;
+	const_string_allocation_scope scope( res );
+	CHECK_THROWS_AS( concat( content, content, "!" ), std::bad_alloc );
+	CHECK( res.last_request > 2 * size + 1 );
+
+	CHECK_THROWS_AS( join( std::vector<const_string>{content, content, content}, "," ), std::bad_alloc );
+	CHECK( res.last_request > 3 * size + 2 );
+}
+#endif
+
 TEST_CASE( "thread" )
 {
 	constexpr int iterations = 1'000'000;
@@ -177,3 +284,376 @@ TEST_CASE( "thread" )
 	REQUIRE( total_s1_fail_cnt == 0 );
 	REQUIRE( total_s2_fail_cnt == 0 );
 }
+
+TEST_CASE( "Short strings don't allocate", "[const_string]" )
+{
+	const auto allocs_before  = detail::stats().get_total_allocs();
+	const auto avoided_before = detail::stats().get_avoided_allocs();
+
+	const_string cs{"Hello"s};
+	REQUIRE( cs == "Hello" );
+	REQUIRE( cs.isZeroTerminated() );
+	requireZero( cs );
+
+	auto combined = concat( "Hel", "lo"s );
+	REQUIRE( combined == "Hello" );
+	requireZero( combined );
+
+	REQUIRE( detail::stats().get_total_allocs() == allocs_before );
+	REQUIRE( detail::stats().get_avoided_allocs() == avoided_before + 2 );
+
+	const_string long_str{std::string( const_string::sso_capacity + 1, 'x' )};
+	REQUIRE( detail::stats().get_total_allocs() == allocs_before + 1 );
+}
+
+TEST_CASE( "Allocating more than max_size throws", "[const_string]" )
+{
+	CHECK_THROWS_AS( detail::allocate_null_terminated_char_buffer( std::numeric_limits<std::size_t>::max() ),
+					 std::length_error );
+	CHECK_THROWS_AS( detail::allocate_null_terminated_char_buffer( detail::atomic_ref_cnt_buffer::max_size ),
+					 std::length_error );
+}
+
+TEST_CASE( "Short strings survive copy, move and swap", "[const_string]" )
+{
+	const_string copy;
+	const_string moved;
+	const_string sub;
+	{
+		const_string cs{"Hello World"s};
+		copy  = cs;
+		sub   = cs.substr( 6 );
+		moved = std::move( cs );
+		cs    = "Overwritten";
+	}
+	REQUIRE( copy == "Hello World" );
+	REQUIRE( moved == "Hello World" );
+	REQUIRE( sub == "World" );
+	requireZero( sub );
+
+	const_string other{"Hi"s};
+	swap( copy, other );
+	REQUIRE( copy == "Hi" );
+	REQUIRE( other == "Hello World" );
+
+	// e.g. done by std::shuffle
+	swap( other, other );
+	REQUIRE( other == "Hello World" );
+	const_string long_str{std::string( const_string::sso_capacity + 10, 'l' )};
+	swap( long_str, long_str );
+	REQUIRE( long_str == std::string( const_string::sso_capacity + 10, 'l' ) );
+	REQUIRE( long_str.get_ref_cnt() == 1 );
+
+	std::vector<const_string> vec;
+	for( int i = 0; i < 100; ++i ) {
+		vec.push_back( const_string{std::to_string( i )} );
+	}
+	for( int i = 0; i < 100; ++i ) {
+		REQUIRE( vec[i] == std::to_string( i ) );
+	}
+}
+
+TEST_CASE( "Short strings split and zstr", "[const_string]" )
+{
+	std::vector<const_string> words;
+	{
+		const_string cs{"a b c"s};
+		words = cs.split_full( ' ' );
+
+		const_zstring zs = cs.substr( 0, 3 );
+		REQUIRE( zs == "a b" );
+		REQUIRE( zs.isZeroTerminated() );
+		requireZero( zs.c_str() );
+	}
+	REQUIRE( words == std::vector<const_string>{"a", "b", "c"} );
+}
+
+TEST_CASE( "Local const_string", "[local_const_string]" )
+{
+	local_const_string ls{"Hello World, how are you?"s};
+	REQUIRE( ls == "Hello World, how are you?" );
+
+	auto copy  = ls;
+	auto words = ls.split_full( ' ' );
+	REQUIRE( words.size() == 5 );
+	REQUIRE( words[1] == "World," );
+
+	local_const_zstring lzs = ls.substr( 6, 5 );
+	REQUIRE( lzs == "World" );
+	requireZero( lzs.c_str() );
+
+	auto combined = concat( ls, "!" );
+	REQUIRE( combined == "Hello World, how are you?!" );
+}
+
+TEST_CASE( "Conversion between ref count policies", "[local_const_string]" )
+{
+	const_string cs{"This string is too long for sso"s};
+
+	const auto allocs_before = detail::stats().get_total_allocs();
+
+	// local string references the shared buffer without copying the characters
+	local_const_string ls( cs.substr( 5 ) );
+	REQUIRE( ls == "string is too long for sso" );
+	REQUIRE( ls.data() == cs.data() + 5 );
+
+	// converting back unwraps the proxy
+	const_string back( ls );
+	REQUIRE( back.data() == ls.data() );
+	REQUIRE( detail::stats().get_total_allocs() == allocs_before + 1 );
+
+	// buffers with a local ref count have to be copied
+	local_const_string ls2{"Another string that is too long"s};
+	const_string       cs2( ls2 );
+	REQUIRE( cs2 == ls2 );
+	REQUIRE( cs2.data() != ls2.data() );
+
+	// literals and short strings
+	local_const_string lit = "Literal";
+	REQUIRE( const_string( lit ).data() == lit.data() );
+	local_const_string ss{"short"s};
+	REQUIRE( const_string( ss ) == "short" );
+
+	local_const_zstring lzs( cs );
+	REQUIRE( lzs == cs );
+	requireZero( lzs.c_str() );
+
+	cs = const_string{};
+	ls = local_const_string{};
+	REQUIRE( back == "string is too long for sso" );
+}
+
+TEST_CASE( "Hash", "[const_string]" )
+{
+	const std::string str = "This string is long enough to require a buffer";
+
+	const_string cs{str};
+	const_string copy = cs;
+	const auto   h    = cs.hash();
+
+	REQUIRE( h == detail::string_hash( str ) );
+	REQUIRE( copy.hash() == h );
+	REQUIRE( std::hash<const_string>{}( cs ) == h );
+	REQUIRE( const_string_hash{}( std::string_view( str ) ) == h );
+	REQUIRE( const_string_hash{}( cs.createZStr() ) == h );
+
+	// substrings, literals and short strings don't use the cache
+	REQUIRE( cs.substr( 5 ).hash() == detail::string_hash( str.substr( 5 ) ) );
+	REQUIRE( cs.substr( 0, 4 ).hash() == const_string( "This" ).hash() );
+	REQUIRE( const_string( "Hello"s ).hash() == const_string( "Hello" ).hash() );
+	REQUIRE( const_string{}.hash() == const_string( "" ).hash() );
+
+	// local proxy has its own cache
+	local_const_string ls( cs );
+	REQUIRE( ls.hash() == h );
+	REQUIRE( ls.hash() == h );
+
+	std::unordered_map<const_string, int> map;
+	map[cs]                = 1;
+	map[const_string{"a"}] = 2;
+	REQUIRE( map.at( const_string( str ) ) == 1 );
+	REQUIRE( map.at( "a" ) == 2 );
+	REQUIRE( const_string_equal{}( cs, str ) );
+}
+
+TEST_CASE( "Adopt buffers", "[const_string]" )
+{
+	SECTION( "std::string" )
+	{
+		std::string  str  = "This string is long enough to require a buffer";
+		const char*  data = str.data();
+		const_string cs( std::move( str ) );
+		REQUIRE( cs == "This string is long enough to require a buffer" );
+		REQUIRE( cs.data() == data );
+		REQUIRE( cs.isZeroTerminated() );
+		REQUIRE( cs.createZStr().data() == data );
+		REQUIRE( cs.substr( 5 ).data() == data + 5 );
+
+		const_zstring zs( std::string( 100, 'z' ) );
+		REQUIRE( zs.c_str()[100] == '\0' );
+
+		// short strings get copied
+		std::string short_str = "short";
+		REQUIRE( const_string( std::move( short_str ) ).get_ref_cnt() == 0 );
+
+		// as do strings that would keep a lot of unused capacity alive
+		std::string reserved = "This string is long enough to require a buffer";
+		reserved.reserve( 100'000 );
+		const char* const  reserved_data = reserved.data();
+		const const_string copied( std::move( reserved ) );
+		REQUIRE( copied == "This string is long enough to require a buffer" );
+		REQUIRE( copied.data() != reserved_data );
+		REQUIRE( copied.retained_bytes() == copied.size() );
+	}
+	SECTION( "unique_ptr and custom deleter" )
+	{
+		int  deleted = 0;
+		auto deleter = [&deleted]( char* p ) {
+			deleted++;
+			delete[] p;
+		};
+
+		std::unique_ptr<char[], decltype( deleter )> buffer( new char[64], deleter );
+		std::fill_n( buffer.get(), 64, 'a' );
+		char* const data = buffer.get();
+		{
+			// no zero terminator
+			const const_string cs = const_string::adopt( std::move( buffer ), 64 );
+			REQUIRE( cs.data() == data );
+			REQUIRE( cs == std::string( 64, 'a' ) );
+			REQUIRE( !cs.isZeroTerminated() );
+
+			const auto zs = cs.createZStr();
+			REQUIRE( zs.data() != data );
+			REQUIRE( zs.c_str()[64] == '\0' );
+			REQUIRE( cs.substr( 0, 20 ).createZStr() == std::string( 20, 'a' ) );
+			REQUIRE( deleted == 0 );
+		}
+		REQUIRE( deleted == 1 );
+
+		char* raw = static_cast<char*>( std::malloc( 32 ) );
+		std::copy_n( "This is a malloc'ed string", 27, raw );
+		const_string cs = const_string::adopt( raw, 26, []( char* p ) { std::free( p ); }, true );
+		REQUIRE( cs == "This is a malloc'ed string" );
+		REQUIRE( cs.createZStr().data() == raw );
+
+		// short strings are copied and the buffer is released immediately
+		const auto short_str = local_const_string::adopt( new char[3]{'a', 'b', 'c'}, 3, std::default_delete<char[]>{} );
+		REQUIRE( short_str == "abc" );
+	}
+}
+
+TEST_CASE( "Compact wasteful substrings", "[const_string]" )
+{
+	const std::string body( 100'000, 'b' );
+
+	const_string parent( body );
+	const_string small = parent.substr( 10, 20 );
+	REQUIRE( small.retained_bytes() == body.size() );
+	REQUIRE( small.wasted_bytes() == body.size() - 20 );
+	REQUIRE( parent.wasted_bytes() == 0 );
+	REQUIRE( const_string( "literal" ).retained_bytes() == 0 );
+	REQUIRE( const_string( "short"s ).retained_bytes() == 0 ); // sso
+
+	// not wasteful
+	REQUIRE( !parent.shrink_if_wasteful() );
+	const_string half = parent.substr( 0, body.size() / 2 );
+	REQUIRE( !half.shrink_if_wasteful() );
+
+	const auto stats_before = detail::stats();
+	REQUIRE( small.shrink_if_wasteful() );
+	REQUIRE( small == body.substr( 10, 20 ) );
+	REQUIRE( small.retained_bytes() == 20 );
+	REQUIRE( small.wasted_bytes() == 0 );
+	REQUIRE( detail::stats().get_compacted_strings() == stats_before.get_compacted_strings() + 1 );
+	REQUIRE( detail::stats().get_released_waste() == stats_before.get_released_waste() + body.size() - 20 );
+
+	// many slices covering the whole buffer are left alone, a few small ones get copied
+	std::vector<const_string> slices = parent.split_full( ' ' );
+	for( std::size_t pos = 0; pos < body.size(); pos += 1000 ) {
+		slices.push_back( parent.substr( pos, 1000 ) );
+	}
+	REQUIRE( const_string::compact( slices ) == 0 );
+
+	std::vector<const_string> few{parent.substr( 0, 100 ), parent.substr( 500, 100 ), const_string( "lit" )};
+	REQUIRE( const_string::compact( few ) == 2 );
+	REQUIRE( few[0] == body.substr( 0, 100 ) );
+	REQUIRE( few[0].retained_bytes() == 100 );
+	REQUIRE( parent.get_ref_cnt() == 1 + 1 + 1 + 100 ); // parent, half, split result, substrings
+
+	// strings sharing a buffer are counted once
+	std::vector<const_string> pinned{parent.substr( 0, 100 ), parent.substr( 500, 100 ), parent.substr( 0, 100 ), small};
+	REQUIRE( const_string::pinned_waste( pinned ) == body.size() - 300 );
+	REQUIRE( const_string::pinned_waste( few ) == 0 );
+}
+
+TEST_CASE( "Runtime statistics", "[const_string]" )
+{
+	const std::string x( 1000, 'x' );
+	const std::string y( 100, 'y' );
+	const auto        before = get_const_string_stats();
+
+	std::vector<const_string> strings;
+	std::thread               t( [&] {
+		// allocations on another thread end up in a different shard
+		strings.push_back( const_string( x ) );
+	} );
+	t.join();
+	strings.push_back( const_string( y ) );
+	auto parts = strings[0].split_full( 'x' );
+	auto cat   = concat( strings[0], strings[1] );
+	auto copy  = strings[1].unshare();
+
+	const auto after = get_const_string_stats();
+	REQUIRE( after.total_allocs == before.total_allocs + 4 );
+	REQUIRE( after.current_allocs == before.current_allocs + 4 );
+	REQUIRE( after.allocated_bytes >= before.allocated_bytes + 1000 + 100 + 1100 + 100 );
+	REQUIRE( after.live_bytes - before.live_bytes
+			 == static_cast<std::int64_t>( after.allocated_bytes - before.allocated_bytes ) );
+	REQUIRE( after.peak_live_bytes >= after.live_bytes );
+	REQUIRE( after.split_calls == before.split_calls + 1 );
+	REQUIRE( after.concat_calls == before.concat_calls + 1 );
+	REQUIRE( after.unshare_calls == before.unshare_calls + 1 );
+	REQUIRE( after.inc_ref_cnt > before.inc_ref_cnt );
+	// the 1000 and 1100 byte buffers (+ header) are in the bucket for [1024, 2048)
+	REQUIRE( after.alloc_size_histogram[11] >= before.alloc_size_histogram[11] + 2 );
+
+	std::uint64_t allocs = 0;
+	after.for_each( [&]( const char* name, auto value ) {
+		if( std::string_view( name ) == "total_allocs" ) {
+			allocs = static_cast<std::uint64_t>( value );
+		}
+	} );
+	REQUIRE( allocs == after.total_allocs );
+
+	strings.clear();
+	parts.clear();
+	REQUIRE( get_const_string_stats().current_allocs == before.current_allocs + 2 );
+}
+
+TEST_CASE( "Immortal strings", "[const_string]" )
+{
+	// immortal buffers are never freed, the arena releases their memory at the end of the test
+	const_string_arena            arena;
+	const_string_allocation_scope scope( arena );
+
+	const std::string body( 100, 'i' );
+	const auto        before = detail::stats();
+
+	const_string name = const_string( body ).make_immortal();
+	REQUIRE( name.is_immortal() );
+	REQUIRE( name == body );
+	REQUIRE( name.get_ref_cnt() == 1 );
+	REQUIRE( !const_string( "literal" ).make_immortal().is_immortal() );
+
+	const auto accesses = detail::stats().get_total_cnt_accesses();
+	{
+		// neither copies nor substrings or splits touch the reference count
+		const_string              copy = name;
+		const_string              sub  = name.substr( 10, 50 );
+		std::vector<const_string> many( 100, name );
+		auto                      parts = name.split_full( 'x' );
+		REQUIRE( copy.is_immortal() );
+		REQUIRE( sub.is_immortal() );
+		REQUIRE( parts[0].is_immortal() );
+		REQUIRE( name.get_ref_cnt() == 1 );
+	}
+	REQUIRE( detail::stats().get_total_cnt_accesses() == accesses );
+
+	// the buffer is never freed
+	name = const_string{};
+	REQUIRE( detail::stats().get_current_allocs() == before.get_current_allocs() + 1 );
+
+	// copies made before the buffer became immortal still count
+	const_string     other( body );
+	const_string     counted = other;
+	const_zstring    zstr    = const_zstring( other ).make_immortal();
+	REQUIRE( zstr.is_immortal() );
+	REQUIRE( other.get_ref_cnt() == 3 );
+	counted = const_string{};
+	REQUIRE( other.get_ref_cnt() == 2 );
+
+	// immortal buffers are not compacted
+	const_string immortal_sub = const_string( std::string( 100'000, 'c' ) ).make_immortal().substr( 0, 10 );
+	REQUIRE( !immortal_sub.shrink_if_wasteful() );
+}